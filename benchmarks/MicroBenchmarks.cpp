@@ -0,0 +1,330 @@
+// Per-operation micro-benchmarks.
+//
+// Every case builds a book (or engine) of a controlled depth and shape
+// outside the measured region, then times one operation repeated `ops`
+// times while the hardware counters run. Each case is repeated REPETITIONS
+// times and the fastest run is reported, one line per case, in a fixed
+// order and format so two runs can be diffed directly:
+//
+//   ./micro_benchmarks [filter] > before.txt
+//
+// Only cases whose name contains `filter` are run.
+
+#include "../src/config/BenchmarkConfig.hpp"
+#include "../src/core/MatchingEngine.hpp"
+#include "../src/gen/RandomOrderGenerator.hpp"
+#include "../src/perf/PerfCounters.hpp"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace tme;
+using namespace tme::perf;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+constexpr size_t REPETITIONS = 5;
+constexpr size_t WRITE_OPS = 10000;        // addOrder / cancelOrder per run
+constexpr size_t READ_OPS = 1000000;       // getBestBid / getVolumeAtPrice per run
+constexpr size_t DEPTHS[] = {1000, 100000};   // Resting orders per side
+constexpr size_t LEVELS[] = {1, 100};         // Price levels they are spread over
+constexpr size_t ENGINE_THREADS = 4;
+constexpr uint32_t MID_PRICE = 10000;
+
+// Keeps read-only loops from being optimised away
+volatile uint64_t sink;
+
+struct Result {
+    double nanos = 0;
+    array<uint64_t, PerfCounters::COUNT> counters{};
+};
+
+class Runner {
+public:
+    Runner(PerfCounters& counters, string filter) : counters_(counters), filter_(move(filter)) {}
+
+    void printHeader() const {
+        cout << "# counters:";
+        for (size_t i = 0; i < PerfCounters::COUNT; ++i) {
+            Counter counter = static_cast<Counter>(i);
+            cout << ' ' << PerfCounters::name(counter) << (counters_.available(counter) ? "" : "(n/a)");
+        }
+        cout << '\n';
+        cout << left << setw(50) << "case" << right << setw(9) << "ops" << setw(11) << "ns/op"
+             << setw(11) << "cycles/op" << setw(11) << "instr/op" << setw(7) << "IPC"
+             << setw(11) << "L1d-mis/op" << setw(11) << "LLC-mis/op" << setw(11) << "br-mis/op" << '\n';
+    }
+
+    // setup runs before every repetition, unmeasured; body is the measured
+    // region and must perform `ops` operations
+    void run(const string& name, size_t ops, const function<void()>& setup, const function<void()>& body) {
+        if (name.find(filter_) == string::npos) {
+            return;
+        }
+
+        Result best;
+        best.nanos = -1;
+        for (size_t rep = 0; rep < REPETITIONS; ++rep) {
+            setup();
+            counters_.start();
+            auto start = steady_clock::now();
+            body();
+            auto elapsed = steady_clock::now() - start;
+            counters_.stop();
+
+            double nanos = static_cast<double>(duration_cast<nanoseconds>(elapsed).count());
+            if (best.nanos < 0 || nanos < best.nanos) {
+                best.nanos = nanos;
+                for (size_t i = 0; i < PerfCounters::COUNT; ++i) {
+                    best.counters[i] = counters_.read(static_cast<Counter>(i));
+                }
+            }
+        }
+        print(name, ops, best);
+    }
+
+private:
+    void print(const string& name, size_t ops, const Result& result) const {
+        double perOp = 1.0 / static_cast<double>(max<size_t>(ops, 1));
+        cout << left << setw(50) << name << right << setw(9) << ops
+             << fixed << setprecision(1) << setw(11) << result.nanos * perOp;
+        printCounter(Counter::CYCLES, result, perOp);
+        printCounter(Counter::INSTRUCTIONS, result, perOp);
+
+        uint64_t cycles = result.counters[static_cast<size_t>(Counter::CYCLES)];
+        uint64_t instructions = result.counters[static_cast<size_t>(Counter::INSTRUCTIONS)];
+        if (counters_.available(Counter::CYCLES) && counters_.available(Counter::INSTRUCTIONS) && cycles > 0) {
+            cout << setw(7) << setprecision(2) << static_cast<double>(instructions) / cycles;
+        } else {
+            cout << setw(7) << "-";
+        }
+
+        printCounter(Counter::L1D_MISSES, result, perOp);
+        printCounter(Counter::LLC_MISSES, result, perOp);
+        printCounter(Counter::BRANCH_MISSES, result, perOp);
+        cout << '\n';
+        cout.flush();
+    }
+
+    void printCounter(Counter counter, const Result& result, double perOp) const {
+        if (!counters_.available(counter)) {
+            cout << setw(11) << "-";
+            return;
+        }
+        cout << setw(11) << setprecision(2) << result.counters[static_cast<size_t>(counter)] * perOp;
+    }
+
+    PerfCounters& counters_;
+    string filter_;
+};
+
+Order makeOrder(uint64_t id, Side side, uint32_t price, uint32_t quantity) {
+    Order order;
+    order.orderId = id;
+    order.symbol = "BENCH";
+    order.price = price;
+    order.quantity = quantity;
+    order.side = side;
+    order.type = OrderType::LIMIT;
+    order.timestamp = steady_clock::now();
+    return order;
+}
+
+// Non-crossing price for the i-th order of a side spread over `levels`
+uint32_t restingPrice(Side side, size_t i, size_t levels) {
+    uint32_t offset = static_cast<uint32_t>(i % levels) + 1;
+    return side == Side::BUY ? MID_PRICE - offset : MID_PRICE + offset;
+}
+
+// `depth` resting orders on each side, ids 1..2*depth
+void fillBook(OrderBook& book, size_t depth, size_t levels) {
+    vector<Order> orders;
+    orders.reserve(2 * depth);
+    for (size_t i = 0; i < depth; ++i) {
+        orders.push_back(makeOrder(2 * i + 1, Side::BUY, restingPrice(Side::BUY, i, levels), 10));
+        orders.push_back(makeOrder(2 * i + 2, Side::SELL, restingPrice(Side::SELL, i, levels), 10));
+    }
+    book.addOrdersBatch(orders);
+}
+
+string shape(size_t depth, size_t levels) {
+    return "/depth=" + to_string(depth) + "/levels=" + to_string(levels);
+}
+
+void bookCases(Runner& runner, size_t depth, size_t levels) {
+    unique_ptr<OrderBook> book;
+    vector<Order> orders;
+    vector<uint64_t> ids;
+    mt19937_64 rng(config::BenchmarkConfig::BENCHMARK_SEED);
+
+    // Non-crossing inserts on top of the resting book
+    runner.run("book.addOrder" + shape(depth, levels), WRITE_OPS,
+        [&] {
+            book = make_unique<OrderBook>("BENCH");
+            fillBook(*book, depth, levels);
+            orders.clear();
+            for (size_t i = 0; i < WRITE_OPS; ++i) {
+                orders.push_back(makeOrder(10 * depth + i, Side::BUY, restingPrice(Side::BUY, i, levels), 10));
+            }
+        },
+        [&] {
+            for (const Order& order : orders) {
+                book->addOrder(order);
+            }
+        });
+
+    // Cancels of random resting orders
+    size_t cancels = min(WRITE_OPS, 2 * depth);
+    runner.run("book.cancelOrder" + shape(depth, levels), cancels,
+        [&] {
+            book = make_unique<OrderBook>("BENCH");
+            fillBook(*book, depth, levels);
+            ids.resize(2 * depth);
+            for (size_t i = 0; i < ids.size(); ++i) {
+                ids[i] = i + 1;
+            }
+            shuffle(ids.begin(), ids.end(), rng);
+            ids.resize(cancels);
+        },
+        [&] {
+            for (uint64_t id : ids) {
+                book->cancelOrder(id);
+            }
+        });
+
+    // One matchOrders call that crosses every resting ask with an equal
+    // number of bids at one price; reported per fill
+    for (MatchingMode mode : {MatchingMode::FIFO, MatchingMode::PRO_RATA}) {
+        const char* policy = mode == MatchingMode::FIFO ? "/fifo" : "/prorata";
+        runner.run(string("book.matchOrders") + policy + shape(depth, levels), depth,
+            [&] {
+                BookConfig config;
+                config.matching = mode;
+                book = make_unique<OrderBook>("BENCH", config);
+                orders.clear();
+                for (size_t i = 0; i < depth; ++i) {
+                    orders.push_back(makeOrder(2 * i + 1, Side::SELL, restingPrice(Side::SELL, i, levels), 10));
+                    orders.push_back(makeOrder(2 * i + 2, Side::BUY, MID_PRICE + static_cast<uint32_t>(levels), 10));
+                }
+                book->addOrdersBatch(orders);
+            },
+            [&] {
+                sink = book->matchOrders().size();
+            });
+    }
+
+    // The same crossing volume against icebergs showing 10 lots out of
+    // 100, so nine in ten fills end in a refill and requeue
+    runner.run("book.matchOrders/iceberg" + shape(depth, levels), depth,
+        [&] {
+            book = make_unique<OrderBook>("BENCH");
+            orders.clear();
+            for (size_t i = 0; i < depth / 10; ++i) {
+                orders.push_back(makeOrder(i + 1, Side::SELL, restingPrice(Side::SELL, i, levels), 100));
+                orders.back().displayQuantity = 10;
+            }
+            for (size_t i = 0; i < depth; ++i) {
+                orders.push_back(makeOrder(depth + i + 1, Side::BUY, MID_PRICE + static_cast<uint32_t>(levels), 10));
+            }
+            book->addOrdersBatch(orders);
+        },
+        [&] {
+            sink = book->matchOrders().size();
+        });
+
+    book = make_unique<OrderBook>("BENCH");
+    fillBook(*book, depth, levels);
+
+    runner.run("book.getBestBid" + shape(depth, levels), READ_OPS, [] {},
+        [&] {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < READ_OPS; ++i) {
+                sum += book->getBestBid();
+            }
+            sink = sum;
+        });
+
+    runner.run("book.getVolumeAtPrice" + shape(depth, levels), READ_OPS, [] {},
+        [&] {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < READ_OPS; ++i) {
+                sum += book->getVolumeAtPrice(Side::SELL, restingPrice(Side::SELL, i, levels));
+            }
+            sink = sum;
+        });
+}
+
+void engineCases(Runner& runner) {
+    unique_ptr<MatchingEngine> engine;
+    vector<Command> commands;
+    vector<Order> orders;
+
+    // One order per call, so every order pays the full dispatch
+    runner.run("engine.processOrder/symbols=1", WRITE_OPS,
+        [&] {
+            engine = make_unique<MatchingEngine>(ENGINE_THREADS);
+            orders.clear();
+            for (size_t i = 0; i < WRITE_OPS; ++i) {
+                Side side = i % 2 ? Side::BUY : Side::SELL;
+                orders.push_back(makeOrder(i + 1, side, restingPrice(side, i, 100), 10));
+            }
+        },
+        [&] {
+            for (const Order& order : orders) {
+                engine->processOrder(order);
+            }
+        });
+
+    for (size_t symbols : {size_t{1}, size_t{100}}) {
+        const size_t batchOrders = 100000;
+        runner.run("engine.processBatch/orders=100000/symbols=" + to_string(symbols), batchOrders,
+            [&] {
+                engine = make_unique<MatchingEngine>(ENGINE_THREADS);
+                gen::RandomOrderGenerator generator(config::BenchmarkConfig::BENCHMARK_SEED, symbols);
+                commands = generator.generate(batchOrders);
+            },
+            [&] {
+                engine->processBatch(commands);
+            });
+    }
+
+    runner.run("engine.cancelOrder/depth=10000", WRITE_OPS,
+        [&] {
+            engine = make_unique<MatchingEngine>(ENGINE_THREADS);
+            commands.clear();
+            for (size_t i = 0; i < WRITE_OPS; ++i) {
+                commands.push_back(NewOrder{makeOrder(i + 1, Side::BUY, restingPrice(Side::BUY, i, 100), 10)});
+            }
+            engine->processBatch(commands);
+        },
+        [&] {
+            for (size_t i = 0; i < WRITE_OPS; ++i) {
+                engine->cancelOrder(i + 1, "BENCH");
+            }
+        });
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // Opened first so engine workers created later inherit the counters
+    PerfCounters counters;
+    Runner runner(counters, argc > 1 ? argv[1] : "");
+    runner.printHeader();
+
+    for (size_t depth : DEPTHS) {
+        for (size_t levels : LEVELS) {
+            bookCases(runner, depth, levels);
+        }
+    }
+    engineCases(runner);
+    return 0;
+}
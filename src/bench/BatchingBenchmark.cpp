@@ -0,0 +1,190 @@
+#include "BatchingBenchmark.hpp"
+#include "../core/CommandBatcher.hpp"
+#include "../core/MatchingEngine.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include "../gen/RandomOrderGenerator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace std::chrono;
+using namespace tme::config;
+using namespace tme::gen;
+
+namespace {
+
+double percentile(vector<int64_t>& samples, double p) {
+    size_t idx = static_cast<size_t>(p * (samples.size() - 1));
+    nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx] / 1000.0;
+}
+
+// Commands arrive on an open-loop schedule: command i is due at
+// start + i / rate whether or not the engine has kept up
+class ArrivalQueue {
+public:
+    ArrivalQueue(size_t count, double rate) : due_(count) {
+        for (size_t i = 0; i < count; ++i) {
+            due_[i] = nanoseconds(static_cast<int64_t>(i * 1e9 / rate));
+        }
+    }
+
+    // Releases every command whose time has come, then sleeps until the
+    // next. Commands [from, to) are handed to `release` if one is given and
+    // otherwise made visible to waitFor.
+    void produce(steady_clock::time_point start, const function<void(size_t, size_t)>& release = nullptr) {
+        size_t next = 0;
+        while (next < due_.size()) {
+            auto now = steady_clock::now();
+            size_t released = next;
+            while (released < due_.size() && start + due_[released] <= now) {
+                ++released;
+            }
+            if (released > next && release) {
+                release(next, released);
+                next = released;
+            } else if (released > next) {
+                {
+                    lock_guard<mutex> lock(mutex_);
+                    arrived_ = released;
+                }
+                ready_.notify_one();
+                next = released;
+            }
+            if (next < due_.size()) {
+                this_thread::sleep_until(max(start + due_[next], now + microseconds(20)));
+            }
+        }
+    }
+
+    // Blocks until at least `wanted` commands past `taken` have arrived, or
+    // all of them have; returns how many have arrived
+    size_t waitFor(size_t taken, size_t wanted) {
+        unique_lock<mutex> lock(mutex_);
+        size_t target = min(taken + wanted, due_.size());
+        ready_.wait(lock, [&] { return arrived_ >= target; });
+        return arrived_;
+    }
+
+    nanoseconds due(size_t i) const { return due_[i]; }
+    size_t size() const { return due_.size(); }
+
+private:
+    vector<nanoseconds> due_;
+    mutex mutex_;
+    condition_variable ready_;
+    size_t arrived_ = 0;
+};
+
+struct Result {
+    double throughput;
+    double meanBatch;
+    double p50;
+    double p99;
+};
+
+// Fixed: wait for a full batch of arrivals, then apply it
+Result runFixed(const vector<Command>& commands, size_t count, double rate) {
+    MatchingEngine engine(BenchmarkConfig::BATCHING_THREADS);
+    ArrivalQueue arrivals(count, rate);
+    vector<int64_t> latencies;
+    latencies.reserve(count);
+    vector<Command> batch;
+    size_t batches = 0;
+
+    auto start = steady_clock::now();
+    thread producer([&] { arrivals.produce(start); });
+
+    size_t taken = 0;
+    while (taken < count) {
+        size_t arrived = arrivals.waitFor(taken, BenchmarkConfig::BATCHING_FIXED_BATCH);
+        size_t size = min(arrived - taken, BenchmarkConfig::BATCHING_FIXED_BATCH);
+        batch.assign(commands.begin() + taken, commands.begin() + taken + size);
+        engine.processBatch(batch);
+        auto applied = steady_clock::now();
+
+        for (size_t i = taken; i < taken + size; ++i) {
+            latencies.push_back(duration_cast<nanoseconds>(applied - (start + arrivals.due(i))).count());
+        }
+        taken += size;
+        ++batches;
+    }
+    double seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    producer.join();
+    return Result{count / seconds, static_cast<double>(count) / batches,
+                  percentile(latencies, 0.50), percentile(latencies, 0.99)};
+}
+
+// Adaptive: arrivals are submitted to a CommandBatcher as they come due
+Result runAdaptive(const vector<Command>& commands, size_t count, double rate) {
+    MatchingEngine engine(BenchmarkConfig::BATCHING_THREADS);
+    ArrivalQueue arrivals(count, rate);
+    vector<int64_t> latencies;
+    latencies.reserve(count);
+    steady_clock::time_point start;
+    BatchStats stats;
+    double seconds = 0;
+    {
+        // Batches are applied in submission order, so the n-th applied
+        // command is the n-th arrival
+        size_t applied = 0;
+        auto onApplied = [&](const vector<Command>& batch) {
+            auto now = steady_clock::now();
+            for (size_t i = applied; i < applied + batch.size(); ++i) {
+                latencies.push_back(duration_cast<nanoseconds>(now - (start + arrivals.due(i))).count());
+            }
+            applied += batch.size();
+        };
+        BatchingConfig config{microseconds(BenchmarkConfig::BATCHING_LATENCY_TARGET_US), 1,
+                              BenchmarkConfig::BATCHING_MAX_BATCH};
+        CommandBatcher batcher(engine, config, onApplied);
+
+        start = steady_clock::now();
+        arrivals.produce(start, [&](size_t from, size_t to) {
+            batcher.submit(vector<Command>(commands.begin() + from, commands.begin() + to));
+        });
+        batcher.flush();
+        seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+        stats = batcher.batchStats();
+    }
+    return Result{count / seconds, stats.batches ? static_cast<double>(stats.items) / stats.batches : 0,
+                  percentile(latencies, 0.50), percentile(latencies, 0.99)};
+}
+
+} // namespace
+
+void runBatchingBenchmark() {
+    size_t maxRate = *max_element(begin(BenchmarkConfig::BATCHING_RATES), end(BenchmarkConfig::BATCHING_RATES));
+    RandomOrderGenerator generator(BenchmarkConfig::BENCHMARK_SEED, BenchmarkConfig::NUM_SYMBOLS);
+    auto commands = generator.generate(static_cast<size_t>(maxRate * BenchmarkConfig::BATCHING_SECONDS));
+
+    cout << "Batching sweep: " << BenchmarkConfig::BATCHING_THREADS << " shards, "
+         << BenchmarkConfig::BATCHING_SECONDS << "s of arrivals per rate. Fixed: batches of "
+         << BenchmarkConfig::BATCHING_FIXED_BATCH << ". Adaptive: CommandBatcher, "
+         << BenchmarkConfig::BATCHING_LATENCY_TARGET_US << "us target" << endl;
+    cout << setw(10) << "mode" << setw(12) << "offered/s" << setw(12) << "applied/s" << setw(10) << "batch"
+         << setw(12) << "p50 (us)" << setw(12) << "p99 (us)" << endl;
+
+    for (size_t rate : BenchmarkConfig::BATCHING_RATES) {
+        size_t count = min(commands.size(), static_cast<size_t>(rate * BenchmarkConfig::BATCHING_SECONDS));
+        for (bool adaptive : {false, true}) {
+            Result result = adaptive ? runAdaptive(commands, count, static_cast<double>(rate))
+                                     : runFixed(commands, count, static_cast<double>(rate));
+            cout << setw(10) << (adaptive ? "adaptive" : "fixed") << setw(12) << rate << fixed
+                 << setprecision(0) << setw(12) << result.throughput << setprecision(1) << setw(10)
+                 << result.meanBatch << setw(12) << result.p50 << setw(12) << result.p99 << endl;
+        }
+    }
+}
+
+} // namespace bench
+} // namespace tme
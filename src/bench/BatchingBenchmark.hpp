@@ -0,0 +1,12 @@
+#pragma once
+
+namespace tme {
+namespace bench {
+
+// Offers orders at a sweep of arrival rates and reports throughput and
+// arrival-to-applied latency with fixed processBatch sizes and with
+// batches sized by a CommandBatcher.
+void runBatchingBenchmark();
+
+} // namespace bench
+} // namespace tme
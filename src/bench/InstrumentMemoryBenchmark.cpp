@@ -0,0 +1,95 @@
+#include "InstrumentMemoryBenchmark.hpp"
+#include "../core/MatchingEngine.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace tme::config;
+
+namespace {
+
+int64_t heapInUse() {
+    return static_cast<int64_t>(mallinfo2().uordblks);
+}
+
+string symbolFor(size_t i) {
+    return "OPT" + to_string(i);
+}
+
+// `perInstrument` resting bids on each of `count` instruments, ids from `firstId`
+vector<Command> restingOrders(size_t count, size_t perInstrument, uint64_t firstId) {
+    vector<Command> commands;
+    commands.reserve(count * perInstrument);
+    for (size_t k = 0; k < perInstrument; ++k) {
+        for (size_t i = 0; i < count; ++i) {
+            Order order;
+            order.orderId = firstId++;
+            order.symbol = symbolFor(i);
+            order.price = static_cast<uint32_t>(100 - k);
+            order.quantity = 1;
+            order.side = Side::BUY;
+            order.type = OrderType::LIMIT;
+            commands.emplace_back(NewOrder{order});
+        }
+    }
+    return commands;
+}
+
+} // namespace
+
+void runInstrumentMemoryBenchmark() {
+    cout << "Heap bytes per instrument" << endl;
+    cout << right << setw(10) << "Symbols" << setw(14) << "compact" << setw(14) << "one order"
+         << setw(14) << "compacted" << setw(14) << (to_string(BenchmarkConfig::MEMORY_FEW_ORDERS) + " orders")
+         << endl;
+
+    for (size_t count : BenchmarkConfig::MEMORY_INSTRUMENT_COUNTS) {
+        auto engine = make_unique<MatchingEngine>(BenchmarkConfig::NUM_THREADS);
+        int64_t base = heapInUse();
+
+        for (size_t i = 0; i < count; ++i) {
+            engine->configureInstrument(symbolFor(i), BookConfig());
+        }
+        int64_t registered = heapInUse();
+
+        // One resting order per instrument promotes every book
+        {
+            vector<Command> commands = restingOrders(count, 1, 1);
+            int64_t beforeActive = heapInUse();
+            engine->processBatch(commands);
+            int64_t active = heapInUse() - beforeActive + (registered - base);
+
+            vector<Command> cancels;
+            cancels.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                cancels.emplace_back(CancelOrder{i + 1, symbolFor(i)});
+            }
+            engine->processBatch(cancels);
+
+            cout << right << setw(10) << count
+                 << setw(14) << fixed << setprecision(1) << static_cast<double>(registered - base) / count
+                 << setw(14) << static_cast<double>(active) / count;
+        }
+
+        engine->compactIdleBooks();
+        cout << setw(14) << static_cast<double>(heapInUse() - base) / count;
+
+        // Near-empty books are not compacted: they stay full books
+        {
+            vector<Command> commands = restingOrders(count, BenchmarkConfig::MEMORY_FEW_ORDERS, count + 1);
+            int64_t beforeFew = heapInUse();
+            engine->processBatch(commands);
+            engine->compactIdleBooks();
+            int64_t few = heapInUse() - beforeFew + (registered - base);
+            cout << setw(14) << static_cast<double>(few) / count << endl;
+        }
+    }
+}
+
+} // namespace bench
+} // namespace tme
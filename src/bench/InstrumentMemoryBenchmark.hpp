@@ -0,0 +1,12 @@
+#pragma once
+
+namespace tme {
+namespace bench {
+
+// Reports heap bytes per instrument for compact, active and re-compacted
+// instruments, and for near-empty ones that compaction keeps as full books,
+// at each instrument count listed in BenchmarkConfig.
+void runInstrumentMemoryBenchmark();
+
+} // namespace bench
+} // namespace tme
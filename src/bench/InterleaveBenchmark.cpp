@@ -0,0 +1,108 @@
+#include "InterleaveBenchmark.hpp"
+#include "../core/MatchingEngine.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace std::chrono;
+using namespace tme::config;
+
+namespace {
+
+Order makeOrder(uint64_t id, size_t symbol, Side side, uint32_t price, uint32_t quantity) {
+    Order order;
+    order.orderId = id;
+    order.symbol = "SYM" + to_string(symbol);
+    order.price = price;
+    order.quantity = quantity;
+    order.side = side;
+    order.type = OrderType::LIMIT;
+    order.timestamp = steady_clock::now();
+    return order;
+}
+
+// Resting depth on every symbol, with ids 1..symbols*depth*2
+vector<Command> makeDepth(mt19937_64& rng) {
+    uniform_int_distribution<uint32_t> ticks(1, BenchmarkConfig::INTERLEAVE_LEVELS);
+    vector<Command> commands;
+    uint64_t id = 1;
+    for (size_t i = 0; i < BenchmarkConfig::INTERLEAVE_DEPTH; ++i) {
+        for (size_t s = 0; s < BenchmarkConfig::INTERLEAVE_SYMBOLS; ++s) {
+            commands.push_back(NewOrder{makeOrder(id++, s, Side::BUY, 10000 - ticks(rng), 10)});
+            commands.push_back(NewOrder{makeOrder(id++, s, Side::SELL, 10000 + ticks(rng), 10)});
+        }
+    }
+    return commands;
+}
+
+// Batches of cancels of random resting orders and new orders, a quarter
+// of which cross the touch, over random symbols
+vector<vector<Command>> makeFlow(mt19937_64& rng) {
+    const uint64_t resting = BenchmarkConfig::INTERLEAVE_SYMBOLS * BenchmarkConfig::INTERLEAVE_DEPTH * 2;
+    uniform_int_distribution<uint64_t> restingId(1, resting);
+    uniform_int_distribution<uint32_t> ticks(1, BenchmarkConfig::INTERLEAVE_LEVELS);
+    uint64_t id = resting + 1;
+
+    vector<vector<Command>> batches(BenchmarkConfig::INTERLEAVE_BATCHES);
+    for (auto& batch : batches) {
+        for (size_t i = 0; i < BenchmarkConfig::INTERLEAVE_BATCH_SIZE; ++i) {
+            uint64_t target = restingId(rng);
+            // Resting ids were assigned symbol-major within each depth row
+            size_t symbol = ((target - 1) / 2) % BenchmarkConfig::INTERLEAVE_SYMBOLS;
+            if (rng() % 2) {
+                batch.push_back(CancelOrder{target, "SYM" + to_string(symbol)});
+                continue;
+            }
+            Side side = rng() % 2 ? Side::BUY : Side::SELL;
+            bool crossing = rng() % 4 == 0;
+            uint32_t price = crossing ? 10000 + (side == Side::BUY ? 1 : -1) * static_cast<int>(ticks(rng) % 3)
+                                      : (side == Side::BUY ? 10000 - ticks(rng) : 10000 + ticks(rng));
+            batch.push_back(NewOrder{makeOrder(id++, symbol, side, price, 1 + static_cast<uint32_t>(rng() % 10))});
+        }
+    }
+    return batches;
+}
+
+} // namespace
+
+void runInterleaveBenchmark() {
+    mt19937_64 rng(BenchmarkConfig::BENCHMARK_SEED);
+    auto depth = makeDepth(rng);
+    auto flow = makeFlow(rng);
+    size_t commands = BenchmarkConfig::INTERLEAVE_BATCHES * BenchmarkConfig::INTERLEAVE_BATCH_SIZE;
+
+    cout << "Interleaved matching: " << BenchmarkConfig::INTERLEAVE_SYMBOLS << " books x "
+         << BenchmarkConfig::INTERLEAVE_DEPTH << " orders per side over " << BenchmarkConfig::INTERLEAVE_LEVELS
+         << " levels, " << commands << " commands in batches of " << BenchmarkConfig::INTERLEAVE_BATCH_SIZE
+         << ", one worker" << endl;
+    cout << setw(8) << "width" << setw(14) << "commands/s" << setw(12) << "ns/cmd" << setw(10) << "speedup" << endl;
+
+    double baseline = 0;
+    for (size_t width : BenchmarkConfig::INTERLEAVE_WIDTHS) {
+        MatchingEngine engine(1);
+        engine.setInterleaveWidth(width);
+        engine.processBatch(depth);
+
+        auto start = steady_clock::now();
+        for (const auto& batch : flow) {
+            engine.processBatch(batch);
+        }
+        double nanos = static_cast<double>(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+        double perCommand = nanos / commands;
+        if (baseline == 0) {
+            baseline = perCommand;
+        }
+        cout << setw(8) << width << fixed << setprecision(0) << setw(14) << commands * 1e9 / nanos
+             << setprecision(1) << setw(12) << perCommand << setprecision(2) << setw(9) << baseline / perCommand
+             << "x" << endl;
+    }
+}
+
+} // namespace bench
+} // namespace tme
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace tme {
+namespace bench {
+
+// Applies the same cancel/add flow over many deep books on one worker,
+// one book at a time and interleaved across 2..16 books with prefetching.
+void runInterleaveBenchmark();
+
+} // namespace bench
+} // namespace tme
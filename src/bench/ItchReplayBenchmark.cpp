@@ -0,0 +1,49 @@
+#include "ItchReplayBenchmark.hpp"
+#include "../feed/ItchReader.hpp"
+#include "../gen/ItchSampleGenerator.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace std::chrono;
+using namespace tme::config;
+using namespace tme::feed;
+
+void runItchReplayBenchmark(const string& path, bool recorded) {
+    string file = path;
+    if (file.empty()) {
+        file = BenchmarkConfig::ITCH_SAMPLE_PATH;
+        cout << "Writing a synthetic sample of " << BenchmarkConfig::ITCH_SAMPLE_MESSAGES << " messages over "
+             << BenchmarkConfig::ITCH_SAMPLE_SYMBOLS << " symbols to " << file << endl;
+        gen::writeItchSample(file, BenchmarkConfig::ITCH_SAMPLE_MESSAGES, BenchmarkConfig::ITCH_SAMPLE_SYMBOLS,
+                             BenchmarkConfig::BENCHMARK_SEED);
+    }
+
+    ItchReader reader(file);
+    MatchingEngine engine(BenchmarkConfig::NUM_THREADS);
+    cout << "Replaying " << file << " (" << reader.fileSize() / (1024 * 1024) << " MiB) "
+         << (recorded ? "at recorded pace" : "at full speed") << ", batches of "
+         << BenchmarkConfig::ITCH_BATCH_SIZE << endl;
+
+    ReplayStats stats = replay(reader, engine, recorded ? ReplayPace::RECORDED : ReplayPace::FULL_SPEED,
+                               BenchmarkConfig::ITCH_BATCH_SIZE);
+
+    uint64_t commands = stats.newOrders + stats.cancels + stats.reduces + stats.replaces;
+    double seconds = duration<double>(stats.elapsed).count();
+    cout << "Messages: " << stats.messages << "  commands: " << commands << "  batches: " << stats.batches << endl;
+    cout << "  adds " << stats.newOrders << "  deletes " << stats.cancels << "  reduces (cancel/execute) "
+         << stats.reduces << "  replaces " << stats.replaces << endl;
+    cout << fixed << setprecision(2) << "  cancel+replace per add: "
+         << static_cast<double>(stats.cancels + stats.replaces) / max<uint64_t>(stats.newOrders, 1) << endl;
+    cout << setprecision(0) << "Elapsed " << stats.elapsed.count() / 1000 << " us, "
+         << commands / max(seconds, 1e-9) << " commands/s, " << setprecision(1)
+         << static_cast<double>(stats.elapsed.count()) / max<uint64_t>(commands, 1) << " ns/command" << endl;
+}
+
+} // namespace bench
+} // namespace tme
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+namespace tme {
+namespace bench {
+
+// Replays an ITCH-style file through the engine and reports the message
+// mix and throughput. Without a path a synthetic sample is written first.
+// `recorded` releases messages at their feed timestamps instead of as fast
+// as possible.
+void runItchReplayBenchmark(const std::string& path, bool recorded);
+
+} // namespace bench
+} // namespace tme
@@ -0,0 +1,62 @@
+#include "MassCancelBenchmark.hpp"
+#include "../core/MatchingEngine.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace std::chrono;
+using namespace tme::config;
+
+void runMassCancelBenchmark() {
+    const uint32_t killedAccount = 1;
+    const size_t accountOrders = BenchmarkConfig::MASS_CANCEL_ORDERS;
+    const size_t totalOrders = accountOrders * BenchmarkConfig::MASS_CANCEL_ACCOUNTS;
+
+    MatchingEngine engine(BenchmarkConfig::NUM_THREADS);
+    mt19937_64 rng(BenchmarkConfig::BENCHMARK_SEED);
+    uniform_int_distribution<uint32_t> symbolDist(0, BenchmarkConfig::NUM_SYMBOLS - 1);
+    uniform_int_distribution<uint32_t> tickDist(0, 500);
+
+    // Non-crossing book: bids below 10000, asks above, so everything rests
+    vector<Command> commands;
+    commands.reserve(totalOrders);
+    for (size_t i = 0; i < totalOrders; ++i) {
+        Order o;
+        o.orderId = i + 1;
+        o.symbol = "SYM" + to_string(symbolDist(rng));
+        o.side = i % 2 ? Side::BUY : Side::SELL;
+        o.price = o.side == Side::BUY ? 9999 - tickDist(rng) : 10001 + tickDist(rng);
+        o.quantity = 1;
+        o.type = OrderType::LIMIT;
+        o.timestamp = steady_clock::now();
+        o.account = static_cast<uint32_t>(i % BenchmarkConfig::MASS_CANCEL_ACCOUNTS) + killedAccount;
+        commands.emplace_back(NewOrder{o});
+    }
+    engine.processBatch(commands);
+
+    auto start = steady_clock::now();
+    engine.processBatch({MassCancel{killedAccount, "", nullopt}});
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+
+    size_t remaining = 0;
+    for (size_t i = 0; i < BenchmarkConfig::NUM_SYMBOLS; ++i) {
+        if (auto book = engine.getOrderBook("SYM" + to_string(i))) {
+            remaining += book->orderCount();
+        }
+    }
+
+    cout << "Mass cancel of " << accountOrders << " orders across " << BenchmarkConfig::NUM_SYMBOLS
+         << " symbols (" << totalOrders << " resting, " << BenchmarkConfig::NUM_THREADS << " shards): "
+         << elapsed.count() << " microseconds, "
+         << fixed << setprecision(1) << elapsed.count() * 1000.0 / accountOrders << " ns/order" << endl;
+    cout << "Orders left resting: " << remaining << " (expected " << totalOrders - accountOrders << ")" << endl;
+}
+
+} // namespace bench
+} // namespace tme
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace tme {
+namespace bench {
+
+// Rests orders for one account across many symbols among other accounts'
+// orders and times a single account-wide MassCancel.
+void runMassCancelBenchmark();
+
+} // namespace bench
+} // namespace tme
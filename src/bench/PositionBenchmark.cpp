@@ -0,0 +1,147 @@
+#include "PositionBenchmark.hpp"
+#include "../core/MatchingEngine.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace std::chrono;
+using namespace tme::config;
+
+namespace {
+
+// Keeps the reader's loads from being optimised away
+volatile double sink;
+
+// Pre-built fill batches for each shard's writer
+vector<vector<vector<Fill>>> makeFillBatches() {
+    const size_t shards = BenchmarkConfig::POSITION_SHARDS;
+    const size_t perShard = BenchmarkConfig::POSITION_FILLS / shards;
+    const size_t perCall = BenchmarkConfig::POSITION_FILLS_PER_CALL;
+    mt19937_64 rng(BenchmarkConfig::BENCHMARK_SEED);
+    uniform_int_distribution<uint32_t> accountDist(1, BenchmarkConfig::POSITION_ACCOUNTS);
+    uniform_int_distribution<uint32_t> priceDist(9900, 10100);
+    uniform_int_distribution<uint32_t> quantityDist(1, 100);
+
+    vector<vector<vector<Fill>>> batches(shards);
+    for (size_t shard = 0; shard < shards; ++shard) {
+        for (size_t done = 0; done < perShard; done += perCall) {
+            vector<Fill> batch(min(perCall, perShard - done));
+            for (Fill& fill : batch) {
+                fill.buy.account = accountDist(rng);
+                fill.sell.account = accountDist(rng);
+                fill.price = priceDist(rng);
+                fill.quantity = quantityDist(rng);
+            }
+            batches[shard].push_back(move(batch));
+        }
+    }
+    return batches;
+}
+
+void runKeeper(const vector<vector<vector<Fill>>>& batches, bool withReader) {
+    const size_t shards = batches.size();
+    PositionKeeper keeper(shards);
+    atomic<bool> done{false};
+    uint64_t reads = 0;
+
+    thread reader;
+    if (withReader) {
+        reader = thread([&] {
+            uint32_t account = 1;
+            double sum = 0;
+            while (!done.load(memory_order_relaxed)) {
+                sum += keeper.exposure(account).grossNotional;
+                account = account % BenchmarkConfig::POSITION_ACCOUNTS + 1;
+                ++reads;
+            }
+            sink = sum;
+        });
+    }
+
+    auto start = steady_clock::now();
+    vector<thread> writers;
+    for (size_t shard = 0; shard < shards; ++shard) {
+        writers.emplace_back([&, shard] {
+            uint32_t instrument = static_cast<uint32_t>(shard);
+            for (const auto& batch : batches[shard]) {
+                keeper.onFills(shard, instrument, batch);
+                instrument = (instrument + static_cast<uint32_t>(shards)) % 1000;
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    done = true;
+    if (reader.joinable()) {
+        reader.join();
+    }
+
+    uint64_t fills = 0;
+    for (const auto& shardBatches : batches) {
+        for (const auto& batch : shardBatches) {
+            fills += batch.size();
+        }
+    }
+    cout << "  " << left << setw(22) << (withReader ? "writers + reader" : "writers only") << right << fixed
+         << setprecision(2) << setw(8) << fills / seconds / 1e6 << " M fills/s";
+    if (withReader) {
+        cout << setw(10) << reads / seconds / 1e6 << " M snapshots/s";
+    }
+    cout << endl;
+}
+
+// Every sell crosses the buy before it at the same price
+double engineFillsPerSecond(bool withAccounts) {
+    MatchingEngine engine(BenchmarkConfig::NUM_THREADS);
+    vector<Command> commands;
+    commands.reserve(BenchmarkConfig::POSITION_ENGINE_ORDERS);
+    for (size_t i = 0; i < BenchmarkConfig::POSITION_ENGINE_ORDERS; ++i) {
+        Order order;
+        order.orderId = i + 1;
+        order.symbol = "SYM" + to_string((i / 2) % BenchmarkConfig::NUM_SYMBOLS);
+        order.side = i % 2 ? Side::SELL : Side::BUY;
+        order.price = 10000;
+        order.quantity = 1;
+        order.type = OrderType::LIMIT;
+        order.timestamp = steady_clock::now();
+        order.account = withAccounts ? static_cast<uint32_t>(i % BenchmarkConfig::POSITION_ACCOUNTS) + 1 : 0;
+        commands.emplace_back(NewOrder{order});
+    }
+
+    auto start = steady_clock::now();
+    engine.processBatch(commands);
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    return BenchmarkConfig::POSITION_ENGINE_ORDERS / 2 / seconds;
+}
+
+} // namespace
+
+void runPositionBenchmark() {
+    cout << "Position keeper: " << BenchmarkConfig::POSITION_FILLS << " fills over "
+         << BenchmarkConfig::POSITION_ACCOUNTS << " accounts, " << BenchmarkConfig::POSITION_SHARDS
+         << " shards, " << BenchmarkConfig::POSITION_FILLS_PER_CALL << " fills per matchOrders call" << endl;
+    auto batches = makeFillBatches();
+    runKeeper(batches, false);
+    runKeeper(batches, true);
+
+    cout << "Engine, " << BenchmarkConfig::POSITION_ENGINE_ORDERS << " orders that all trade:" << endl;
+    double untracked = engineFillsPerSecond(false);
+    double tracked = engineFillsPerSecond(true);
+    cout << "  " << left << setw(22) << "account 0 (untracked)" << right << fixed << setprecision(2) << setw(8)
+         << untracked / 1e6 << " M fills/s" << endl;
+    cout << "  " << left << setw(22) << "with accounts" << right << setw(8) << tracked / 1e6 << " M fills/s"
+         << endl;
+}
+
+} // namespace bench
+} // namespace tme
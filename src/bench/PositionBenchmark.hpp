@@ -0,0 +1,12 @@
+#pragma once
+
+namespace tme {
+namespace bench {
+
+// Drives the position keeper with one writer thread per shard, with and
+// without a concurrent snapshot reader, then measures what position
+// keeping adds to an engine run where every order trades.
+void runPositionBenchmark();
+
+} // namespace bench
+} // namespace tme
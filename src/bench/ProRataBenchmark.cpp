@@ -0,0 +1,100 @@
+#include "ProRataBenchmark.hpp"
+#include "../core/OrderBook.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace std::chrono;
+using namespace tme::config;
+
+namespace {
+
+const char* modeName(MatchingMode mode) {
+    switch (mode) {
+        case MatchingMode::PRO_RATA: return "PRO_RATA";
+        case MatchingMode::FIFO_LMM: return "FIFO_LMM";
+        default: return "FIFO";
+    }
+}
+
+// Builds one level of `depth` resting bids, crosses it with a sell for half
+// of its volume and returns the time spent inside matchOrders.
+nanoseconds timeOneCrossing(const BookConfig& config, size_t depth, mt19937_64& rng, size_t& fills) {
+    uniform_int_distribution<uint32_t> qtyDist(1, 100);
+    OrderBook book("DEEP", config);
+
+    vector<Order> orders;
+    orders.reserve(depth + 1);
+    uint64_t levelVolume = 0;
+    for (size_t i = 0; i < depth; ++i) {
+        Order o;
+        o.orderId = i + 1;
+        o.symbol = "DEEP";
+        o.price = 100;
+        o.quantity = qtyDist(rng);
+        o.side = Side::BUY;
+        o.type = OrderType::LIMIT;
+        o.account = static_cast<uint32_t>(i % 64);
+        levelVolume += o.quantity;
+        orders.push_back(o);
+    }
+    Order aggressor = orders.back();
+    aggressor.orderId = depth + 1;
+    aggressor.side = Side::SELL;
+    aggressor.quantity = static_cast<uint32_t>(levelVolume / 2);
+    orders.push_back(aggressor);
+    book.addOrdersBatch(orders);
+
+    auto start = steady_clock::now();
+    auto result = book.matchOrders();
+    auto end = steady_clock::now();
+
+    fills += result.size();
+    return duration_cast<nanoseconds>(end - start);
+}
+
+} // namespace
+
+void runProRataBenchmark() {
+    mt19937_64 rng(BenchmarkConfig::BENCHMARK_SEED);
+
+    BookConfig lmm{MatchingMode::FIFO_LMM, LockingMode::NONE};
+    lmm.lmmAccount = 1;
+    lmm.lmmAllocationPercent = 40;
+    const vector<BookConfig> configs = {
+        BookConfig{MatchingMode::FIFO, LockingMode::NONE},
+        BookConfig{MatchingMode::PRO_RATA, LockingMode::NONE},
+        lmm,
+    };
+
+    cout << "Deep level allocation benchmark (" << BenchmarkConfig::PRO_RATA_ITERATIONS
+         << " crossings per case)" << endl;
+    cout << left << setw(10) << "Policy" << right << setw(10) << "Depth"
+         << setw(16) << "us/crossing" << setw(16) << "ns/resting" << setw(12) << "fills" << endl;
+
+    for (size_t depth : BenchmarkConfig::PRO_RATA_LEVEL_DEPTHS) {
+        for (const BookConfig& config : configs) {
+            nanoseconds total{0};
+            size_t fills = 0;
+            for (size_t i = 0; i < BenchmarkConfig::PRO_RATA_ITERATIONS; ++i) {
+                total += timeOneCrossing(config, depth, rng, fills);
+            }
+
+            double perCrossing = static_cast<double>(total.count()) / BenchmarkConfig::PRO_RATA_ITERATIONS;
+            cout << left << setw(10) << modeName(config.matching) << right << setw(10) << depth
+                 << setw(16) << fixed << setprecision(2) << perCrossing / 1000.0
+                 << setw(16) << perCrossing / depth
+                 << setw(12) << fills / BenchmarkConfig::PRO_RATA_ITERATIONS << endl;
+        }
+    }
+}
+
+} // namespace bench
+} // namespace tme
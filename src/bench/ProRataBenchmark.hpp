@@ -0,0 +1,11 @@
+#pragma once
+
+namespace tme {
+namespace bench {
+
+// Times matchOrders against a single deep resting level for each allocation
+// policy, at the level depths listed in BenchmarkConfig.
+void runProRataBenchmark();
+
+} // namespace bench
+} // namespace tme
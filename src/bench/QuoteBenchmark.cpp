@@ -0,0 +1,170 @@
+#include "QuoteBenchmark.hpp"
+#include "../core/MatchingEngine.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace std::chrono;
+using namespace tme::config;
+
+namespace {
+
+constexpr uint32_t MAKER = 7;
+constexpr uint32_t MID_PRICE = 10000;
+
+string symbolOf(size_t instrument) {
+    return "Q" + to_string(instrument);
+}
+
+// Other accounts' resting depth under and over the maker's quotes
+vector<Command> makeDepth() {
+    vector<Command> commands;
+    uint64_t id = 1;
+    for (size_t i = 0; i < BenchmarkConfig::QUOTE_INSTRUMENTS; ++i) {
+        for (uint32_t level = 1; level <= BenchmarkConfig::QUOTE_DEPTH; ++level) {
+            for (Side side : {Side::BUY, Side::SELL}) {
+                Order order;
+                order.orderId = id++;
+                order.symbol = symbolOf(i);
+                order.price = side == Side::BUY ? MID_PRICE - 5 - level : MID_PRICE + 5 + level;
+                order.quantity = 10;
+                order.side = side;
+                order.type = OrderType::LIMIT;
+                order.account = 1;
+                order.timestamp = steady_clock::now();
+                commands.push_back(NewOrder{order});
+            }
+        }
+    }
+    return commands;
+}
+
+// One round of quotes per instrument: mostly size changes at the same
+// price, some one-tick moves, never crossing
+vector<vector<Quote>> makeRounds(size_t rounds) {
+    mt19937_64 rng(BenchmarkConfig::BENCHMARK_SEED);
+    vector<uint32_t> bidPrice(BenchmarkConfig::QUOTE_INSTRUMENTS, MID_PRICE - 2);
+    vector<uint32_t> askPrice(BenchmarkConfig::QUOTE_INSTRUMENTS, MID_PRICE + 2);
+    vector<uint32_t> size(BenchmarkConfig::QUOTE_INSTRUMENTS, 100);
+
+    vector<vector<Quote>> quotes(rounds);
+    for (auto& round : quotes) {
+        for (size_t i = 0; i < BenchmarkConfig::QUOTE_INSTRUMENTS; ++i) {
+            uint64_t roll = rng() % 10;
+            if (roll < 6) {
+                size[i] = size[i] > 20 ? size[i] - 1 - static_cast<uint32_t>(rng() % 10) : 100;
+            } else if (roll < 9) {
+                int move = rng() % 2 ? 1 : -1;
+                bidPrice[i] = MID_PRICE - 2 + move;
+                askPrice[i] = MID_PRICE + 2 + move;
+            } else {
+                size[i] += 10;
+            }
+            round.push_back(Quote{MAKER, symbolOf(i), bidPrice[i], size[i], askPrice[i], size[i], steady_clock::now()});
+        }
+    }
+    return quotes;
+}
+
+// Orders of instrument i use ids from here on, two per round
+uint64_t firstIdOf(size_t instrument) {
+    return (instrument + 1) << 40;
+}
+
+// The same quote as cancels of the previous pair and a new order per side
+void appendCancelNew(const Quote& quote, uint64_t firstId, uint64_t& nextId, vector<Command>& commands) {
+    if (nextId > firstId) {
+        commands.push_back(CancelOrder{nextId - 2, quote.symbol});
+        commands.push_back(CancelOrder{nextId - 1, quote.symbol});
+    }
+    for (Side side : {Side::BUY, Side::SELL}) {
+        Order order;
+        order.orderId = nextId++;
+        order.symbol = quote.symbol;
+        order.price = side == Side::BUY ? quote.bidPrice : quote.askPrice;
+        order.quantity = side == Side::BUY ? quote.bidQuantity : quote.askQuantity;
+        order.side = side;
+        order.type = OrderType::LIMIT;
+        order.account = MAKER;
+        order.timestamp = quote.timestamp;
+        commands.push_back(NewOrder{order});
+    }
+}
+
+void report(const char* label, size_t quotes, steady_clock::duration elapsed) {
+    double seconds = duration_cast<duration<double>>(elapsed).count();
+    cout << left << setw(34) << label << right << fixed << setprecision(0) << setw(14) << quotes / seconds
+         << setprecision(1) << setw(12) << seconds * 1e9 / quotes << endl;
+}
+
+} // namespace
+
+void runQuoteBenchmark() {
+    const size_t instruments = BenchmarkConfig::QUOTE_INSTRUMENTS;
+    auto depth = makeDepth();
+    auto rounds = makeRounds(BenchmarkConfig::QUOTE_ROUNDS);
+
+    cout << "Mass quoting: " << instruments << " instruments, " << BenchmarkConfig::QUOTE_DEPTH
+         << " levels of other depth per side, " << BenchmarkConfig::NUM_THREADS << " shards" << endl;
+    cout << left << setw(34) << "mode" << right << setw(14) << "quotes/s" << setw(12) << "ns/quote" << endl;
+
+    // Every cancel and order either goes through its own engine call or
+    // the round is submitted as one batch
+    auto cancelNew = [&](bool oneBatchPerRound, size_t roundCount) {
+        MatchingEngine engine(BenchmarkConfig::NUM_THREADS);
+        engine.processBatch(depth);
+        vector<uint64_t> nextIds(instruments);
+        for (size_t i = 0; i < instruments; ++i) {
+            nextIds[i] = firstIdOf(i);
+        }
+        vector<Command> commands;
+
+        auto start = steady_clock::now();
+        for (size_t r = 0; r < roundCount; ++r) {
+            commands.clear();
+            for (size_t i = 0; i < instruments; ++i) {
+                appendCancelNew(rounds[r][i], firstIdOf(i), nextIds[i], commands);
+            }
+            if (oneBatchPerRound) {
+                engine.processBatch(commands);
+                continue;
+            }
+            for (const Command& cmd : commands) {
+                if (const auto* cancel = get_if<CancelOrder>(&cmd)) {
+                    engine.cancelOrder(cancel->orderId, cancel->symbol);
+                } else {
+                    engine.processOrder(get<NewOrder>(cmd).order);
+                }
+            }
+        }
+        return steady_clock::now() - start;
+    };
+
+    size_t singleRounds = BenchmarkConfig::QUOTE_SINGLE_ROUNDS;
+    report("cancel + new, one call each", singleRounds * instruments, cancelNew(false, singleRounds));
+    report("cancel + new, one batch per round", rounds.size() * instruments, cancelNew(true, rounds.size()));
+
+    MatchingEngine engine(BenchmarkConfig::NUM_THREADS);
+    engine.processBatch(depth);
+    MassQuote massQuote;
+    MassQuoteAck totals;
+    auto start = steady_clock::now();
+    for (auto& round : rounds) {
+        massQuote.quotes.swap(round);
+        MassQuoteAck ack = engine.processMassQuote(massQuote);
+        totals.sidesKept += ack.sidesKept;
+        totals.sidesRequeued += ack.sidesRequeued;
+        massQuote.quotes.swap(round);
+    }
+    report("mass quote per round", rounds.size() * instruments, steady_clock::now() - start);
+    cout << "  sides kept in place: " << totals.sidesKept << ", requeued: " << totals.sidesRequeued << endl;
+}
+
+} // namespace bench
+} // namespace tme
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace tme {
+namespace bench {
+
+// Re-quotes a market maker's two-sided quotes on many instruments, first
+// as cancel + new order messages and then as mass quotes.
+void runQuoteBenchmark();
+
+} // namespace bench
+} // namespace tme
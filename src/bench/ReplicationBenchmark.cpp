@@ -0,0 +1,153 @@
+#include "ReplicationBenchmark.hpp"
+#include "../repl/Replication.hpp"
+#include "../gen/RandomOrderGenerator.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace std::chrono;
+using namespace tme::config;
+using namespace tme::gen;
+using namespace tme::repl;
+
+namespace {
+
+enum class Mode {
+    STANDALONE,     // No follower
+    PIPELINED,      // Up to REPL_MAX_IN_FLIGHT unacknowledged batches
+    SYNCHRONOUS     // Wait for each batch's ack before the next
+};
+
+double percentile(vector<int64_t>& samples, double p) {
+    size_t idx = static_cast<size_t>(p * (samples.size() - 1));
+    nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx] / 1000.0;
+}
+
+vector<vector<Command>> makeBatches() {
+    RandomOrderGenerator generator(BenchmarkConfig::BENCHMARK_SEED, BenchmarkConfig::NUM_SYMBOLS);
+    auto commands = generator.generate(BenchmarkConfig::REPL_ORDERS);
+    vector<vector<Command>> batches;
+    for (size_t i = 0; i < commands.size(); i += BenchmarkConfig::REPL_BATCH_SIZE) {
+        size_t end = min(commands.size(), i + BenchmarkConfig::REPL_BATCH_SIZE);
+        batches.emplace_back(commands.begin() + i, commands.begin() + end);
+    }
+    return batches;
+}
+
+// Child process: a follower engine on a free loopback port, reported to the
+// parent through the pipe
+int runFollower(int portPipe) {
+    MatchingEngine engine(BenchmarkConfig::NUM_THREADS);
+    ReplicationFollower follower(engine, 0);
+    uint16_t port = follower.port();
+    if (write(portPipe, &port, sizeof(port)) != sizeof(port)) {
+        return 1;
+    }
+    close(portPipe);
+    follower.run();
+    return 0;
+}
+
+void report(const char* label, size_t orders, microseconds elapsed, vector<int64_t>& latencies) {
+    cout << left << setw(12) << label << right
+         << fixed << setprecision(0) << setw(12) << orders * 1e6 / max<int64_t>(elapsed.count(), 1)
+         << setprecision(2)
+         << setw(12) << percentile(latencies, 0.50)
+         << setw(12) << percentile(latencies, 0.99)
+         << setw(12) << percentile(latencies, 1.0) << endl;
+}
+
+void runMode(const char* label, Mode mode, const vector<vector<Command>>& batches) {
+    pid_t child = -1;
+    uint16_t port = 0;
+    if (mode != Mode::STANDALONE) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            cerr << "Error: pipe failed" << endl;
+            return;
+        }
+        cout.flush();
+        child = fork();
+        if (child < 0) {
+            cerr << "Error: fork failed" << endl;
+            return;
+        }
+        if (child == 0) {
+            close(fds[0]);
+            _exit(runFollower(fds[1]));
+        }
+        close(fds[1]);
+        ssize_t got = read(fds[0], &port, sizeof(port));
+        close(fds[0]);
+        if (got != sizeof(port)) {
+            cerr << "Error: follower did not start" << endl;
+            waitpid(child, nullptr, 0);
+            return;
+        }
+    }
+
+    vector<int64_t> latencies;
+    latencies.reserve(batches.size());
+    size_t orders = 0;
+    microseconds elapsed{};
+    {
+        MatchingEngine engine(BenchmarkConfig::NUM_THREADS);
+        unique_ptr<ReplicationPrimary> primary;
+        if (mode != Mode::STANDALONE) {
+            primary = make_unique<ReplicationPrimary>(engine, "127.0.0.1", port,
+                                                      BenchmarkConfig::REPL_MAX_IN_FLIGHT);
+        }
+
+        auto start = steady_clock::now();
+        for (const auto& batch : batches) {
+            auto batchStart = steady_clock::now();
+            if (!primary) {
+                engine.processBatch(batch);
+            } else {
+                uint64_t sequence = primary->processBatch(batch);
+                if (mode == Mode::SYNCHRONOUS) {
+                    primary->waitForAck(sequence);
+                }
+            }
+            latencies.push_back(duration_cast<nanoseconds>(steady_clock::now() - batchStart).count());
+            orders += batch.size();
+        }
+        // Throughput counts a run as done once the follower has caught up
+        if (primary) {
+            primary->waitForAck(primary->lastSentSequence());
+        }
+        elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+    }
+
+    if (child > 0) {
+        waitpid(child, nullptr, 0);
+    }
+    report(label, orders, elapsed, latencies);
+}
+
+} // namespace
+
+void runReplicationBenchmark() {
+    auto batches = makeBatches();
+    cout << "Replication benchmark: " << BenchmarkConfig::REPL_ORDERS << " orders in batches of "
+         << BenchmarkConfig::REPL_BATCH_SIZE << ", " << BenchmarkConfig::REPL_MAX_IN_FLIGHT
+         << " batches in flight, loopback follower" << endl;
+    cout << left << setw(12) << "mode" << right << setw(12) << "orders/s" << setw(12) << "p50 (us)"
+         << setw(12) << "p99 (us)" << setw(12) << "max (us)" << endl;
+
+    runMode("standalone", Mode::STANDALONE, batches);
+    runMode("pipelined", Mode::PIPELINED, batches);
+    runMode("synchronous", Mode::SYNCHRONOUS, batches);
+}
+
+} // namespace bench
+} // namespace tme
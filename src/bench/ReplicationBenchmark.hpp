@@ -0,0 +1,12 @@
+#pragma once
+
+namespace tme {
+namespace bench {
+
+// Runs the same order stream standalone, replicated to a forked follower
+// process over loopback TCP (pipelined), and replicated with a wait for
+// every ack, and reports what replication costs in throughput and latency.
+void runReplicationBenchmark();
+
+} // namespace bench
+} // namespace tme
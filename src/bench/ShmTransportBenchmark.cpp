@@ -0,0 +1,111 @@
+#include "ShmTransportBenchmark.hpp"
+#include "../transport/ShmTransport.hpp"
+#include "../gen/RandomOrderGenerator.hpp"
+#include "../config/BenchmarkConfig.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace tme {
+namespace bench {
+
+using namespace std;
+using namespace std::chrono;
+using namespace tme::config;
+using namespace tme::gen;
+using namespace tme::transport;
+
+namespace {
+
+int64_t nowNanos() {
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+double percentile(vector<int64_t>& samples, double p) {
+    size_t idx = static_cast<size_t>(p * (samples.size() - 1));
+    nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx] / 1000.0;
+}
+
+// Child process: keeps up to SHM_MAX_IN_FLIGHT commands outstanding and
+// times each one from send until its acknowledgement arrives.
+int runGateway() {
+    RandomOrderGenerator generator(BenchmarkConfig::BENCHMARK_SEED, BenchmarkConfig::NUM_SYMBOLS);
+    auto commands = generator.generate(BenchmarkConfig::SHM_MESSAGES);
+
+    unique_ptr<ShmGatewayClient> client;
+    while (!client) {
+        try {
+            client = make_unique<ShmGatewayClient>(BenchmarkConfig::SHM_SEGMENT_NAME);
+        } catch (const exception&) {
+            this_thread::sleep_for(milliseconds(1));   // Engine not up yet
+        }
+    }
+
+    vector<int64_t> roundTrips;
+    roundTrips.reserve(commands.size());
+    size_t sent = 0;
+    size_t acked = 0;
+
+    auto start = steady_clock::now();
+    while (acked < commands.size()) {
+        while (sent < commands.size() && sent - acked < BenchmarkConfig::SHM_MAX_IN_FLIGHT &&
+               client->trySend(commands[sent])) {
+            ++sent;
+        }
+        ResponseRecord response;
+        while (client->pollResponse(response)) {
+            roundTrips.push_back(nowNanos() - response.sendTimeNanos);
+            ++acked;
+        }
+    }
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+
+    cout << "Gateway: " << acked << " commands acknowledged in " << elapsed.count() << " microseconds ("
+         << fixed << setprecision(0) << acked * 1e6 / max<int64_t>(elapsed.count(), 1) << " msg/s)" << endl;
+    cout << "Round trip (us): p50 " << setprecision(2) << percentile(roundTrips, 0.50)
+         << "  p99 " << percentile(roundTrips, 0.99)
+         << "  p99.9 " << percentile(roundTrips, 0.999)
+         << "  max " << percentile(roundTrips, 1.0) << endl;
+    return 0;
+}
+
+} // namespace
+
+void runShmTransportBenchmark() {
+    cout << "Shared memory transport benchmark: " << BenchmarkConfig::SHM_MESSAGES << " orders, "
+         << BenchmarkConfig::SHM_MAX_IN_FLIGHT << " in flight" << endl;
+    cout.flush();
+
+    pid_t gateway = fork();
+    if (gateway < 0) {
+        cerr << "Error: fork failed" << endl;
+        return;
+    }
+    if (gateway == 0) {
+        _exit(runGateway());
+    }
+
+    {
+        MatchingEngine engine(BenchmarkConfig::NUM_THREADS);
+        ShmCommandReceiver receiver(engine, BenchmarkConfig::SHM_SEGMENT_NAME);
+
+        size_t processed = 0;
+        while (processed < BenchmarkConfig::SHM_MESSAGES) {
+            processed += receiver.poll(BenchmarkConfig::SHM_DRAIN_BATCH);
+        }
+
+        int status = 0;
+        waitpid(gateway, &status, 0);
+        if (receiver.droppedResponses() > 0) {
+            cout << "Engine dropped " << receiver.droppedResponses() << " acknowledgements" << endl;
+        }
+    }
+}
+
+} // namespace bench
+} // namespace tme
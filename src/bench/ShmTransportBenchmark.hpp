@@ -0,0 +1,11 @@
+#pragma once
+
+namespace tme {
+namespace bench {
+
+// Forks a gateway process that streams orders to this process over the
+// shared memory rings and reports cross-process round-trip latency.
+void runShmTransportBenchmark();
+
+} // namespace bench
+} // namespace tme
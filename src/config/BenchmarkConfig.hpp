@@ -14,6 +14,65 @@ public:
     static constexpr uint64_t NUM_SYMBOLS = 100;
     static constexpr size_t NUM_THREADS = 16;  // Number of worker threads
     static constexpr const char* OUTPUT_FILE = "../benchmark_results.csv";
+    static constexpr uint64_t BENCHMARK_SEED = 42;  // Every generated workload, so runs are comparable
+    
+    // Deep level allocation benchmark ("prorata")
+    static constexpr size_t PRO_RATA_LEVEL_DEPTHS[] = {100, 1000, 5000, 20000};
+    static constexpr size_t PRO_RATA_ITERATIONS = 50;
+    
+    // Cross-process shared memory transport benchmark ("shm")
+    static constexpr const char* SHM_SEGMENT_NAME = "/tme_bench_rings";
+    static constexpr size_t SHM_MESSAGES = 1000000;
+    static constexpr size_t SHM_MAX_IN_FLIGHT = 1024;
+    static constexpr size_t SHM_DRAIN_BATCH = 256;
+    
+    // Memory per instrument benchmark ("memory")
+    static constexpr size_t MEMORY_INSTRUMENT_COUNTS[] = {1000, 100000, 1000000};
+    static constexpr size_t MEMORY_FEW_ORDERS = 3;     // Resting orders of a near-empty book
+    
+    // Account-wide kill switch benchmark ("masscancel")
+    static constexpr size_t MASS_CANCEL_ORDERS = 100000;   // Orders of the cancelled account
+    static constexpr size_t MASS_CANCEL_ACCOUNTS = 4;      // Accounts sharing the books
+    
+    // Hot-standby replication benchmark ("replication")
+    static constexpr size_t REPL_ORDERS = 1000000;
+    static constexpr size_t REPL_BATCH_SIZE = 1000;       // Commands per replicated batch
+    static constexpr size_t REPL_MAX_IN_FLIGHT = 64;      // Unacknowledged batches allowed
+    
+    // Feed replay benchmark ("itch"); the sample is written when no file is given
+    static constexpr const char* ITCH_SAMPLE_PATH = "/tmp/tme_itch_sample.bin";
+    static constexpr size_t ITCH_SAMPLE_MESSAGES = 2000000;
+    static constexpr size_t ITCH_SAMPLE_SYMBOLS = 100;
+    static constexpr size_t ITCH_BATCH_SIZE = 1000;
+    
+    // Position keeping benchmark ("positions")
+    static constexpr size_t POSITION_FILLS = 10000000;
+    static constexpr size_t POSITION_ACCOUNTS = 1000;
+    static constexpr size_t POSITION_SHARDS = 4;
+    static constexpr size_t POSITION_FILLS_PER_CALL = 64;
+    static constexpr size_t POSITION_ENGINE_ORDERS = 1000000;
+    
+    // Interleaved multi-book matching benchmark ("interleave"); width 1 is the sequential path
+    static constexpr size_t INTERLEAVE_WIDTHS[] = {1, 2, 4, 8, 16};
+    static constexpr size_t INTERLEAVE_SYMBOLS = 256;
+    static constexpr size_t INTERLEAVE_DEPTH = 1000;       // Resting orders per side per book
+    static constexpr uint32_t INTERLEAVE_LEVELS = 200;
+    static constexpr size_t INTERLEAVE_BATCHES = 100;
+    static constexpr size_t INTERLEAVE_BATCH_SIZE = 10000;
+    
+    // Market maker quoting benchmark ("quotes")
+    static constexpr size_t QUOTE_INSTRUMENTS = 500;
+    static constexpr uint32_t QUOTE_DEPTH = 20;           // Levels of other accounts' orders per side
+    static constexpr size_t QUOTE_ROUNDS = 200;           // Batched and mass quote runs
+    static constexpr size_t QUOTE_SINGLE_ROUNDS = 5;      // One engine call per message
+    
+    // Arrival rate sweep, fixed vs adaptive batching ("batching")
+    static constexpr size_t BATCHING_RATES[] = {20000, 100000, 300000, 600000, 1000000};
+    static constexpr double BATCHING_SECONDS = 0.5;        // Arrivals offered per rate
+    static constexpr size_t BATCHING_THREADS = 4;
+    static constexpr size_t BATCHING_FIXED_BATCH = 1000;   // Commands per processBatch, fixed setting
+    static constexpr int64_t BATCHING_LATENCY_TARGET_US = 50;
+    static constexpr size_t BATCHING_MAX_BATCH = 10000;
     
     // Test description
     static const std::string TEST_DESCRIPTION;
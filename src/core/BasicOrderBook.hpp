@@ -0,0 +1,443 @@
+#pragma once
+
+#include "BookPolicies.hpp"
+#include "OrderIndex.hpp"
+#include <unordered_map>
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+
+namespace tme {
+
+using namespace std;
+
+// What a quote did to its side of the book
+enum class QuoteUpdate {
+    NONE,       // Zero quantity and nothing resting
+    KEPT,       // Same price, same or smaller size: priority kept
+    REQUEUED,   // New quote, new price or larger size: back of the level
+    PULLED      // Zero quantity removed the resting quote
+};
+
+/**
+ * Order book template specialised at compile time on:
+ *   - MatchPolicy:    how crossing levels are allocated (see BookPolicies.hpp)
+ *   - LockPolicy:     NoLocking for single-writer books, SharedMutexLocking otherwise
+ *
+ * Each side is its own map type ordered by SideTraits<S>::Compare, and every
+ * per-side operation is a template on Side, so the only runtime branch left
+ * on the hot path is the single dispatchSide on order.side.
+ */
+template <typename MatchPolicy, typename LockPolicy>
+class BasicOrderBook {
+public:
+    using Price = uint32_t;
+    using Mutex = typename LockPolicy::Mutex;
+
+    explicit BasicOrderBook(const string& symbol, MatchPolicy policy = MatchPolicy())
+        : symbol_(symbol), policy_(move(policy)) {}
+
+    BasicOrderBook(const BasicOrderBook&) = delete;
+    BasicOrderBook& operator=(const BasicOrderBook&) = delete;
+
+    void addOrder(const Order& order) {
+        unique_lock<Mutex> lock(mutex_);
+        insert(order);
+    }
+
+    void addOrdersBatch(const vector<Order>& orders) {
+        unique_lock<Mutex> lock(mutex_);
+        for (const Order& order : orders) {
+            insert(order);
+        }
+    }
+
+    // Adds and matches each order in turn under a single lock acquisition,
+    // so the fills are those of adding and matching the orders one by one
+    // however many are passed at once.
+    vector<Fill> addAndMatchOrders(const vector<Order>& orders) {
+        unique_lock<Mutex> lock(mutex_);
+        vector<Fill> matches;
+        for (const Order& order : orders) {
+            insert(order);
+            match(matches);
+        }
+        return matches;
+    }
+
+    bool cancelOrder(uint64_t orderId) {
+        unique_lock<Mutex> lock(mutex_);
+        return remove(orderId);
+    }
+
+    // Cancels every listed order under a single lock acquisition and returns
+    // how many were still resting.
+    size_t cancelOrdersBatch(const vector<uint64_t>& orderIds) {
+        unique_lock<Mutex> lock(mutex_);
+        size_t cancelled = 0;
+        for (uint64_t orderId : orderIds) {
+            cancelled += remove(orderId) ? 1 : 0;
+        }
+        return cancelled;
+    }
+
+    // Takes quantity off a resting order without changing its priority,
+    // removing it once nothing is left. An iceberg order gives up hidden
+    // reserve before displayed quantity. Returns false if it isn't resting.
+    bool reduceOrder(uint64_t orderId, uint32_t quantity) {
+        unique_lock<Mutex> lock(mutex_);
+        auto* lookup = orderLookup_.find(orderId);
+        if (!lookup) {
+            return false;
+        }
+        RestingOrder& order = *lookup->second;
+        if (quantity >= order.quantity + uint64_t{order.reserve}) {
+            remove(orderId);
+        } else {
+            dispatchSide(order.side, [&](auto side) {
+                reduce<decltype(side)::value>(lookup->first, order, quantity);
+            });
+        }
+        return true;
+    }
+
+    // Cancels a resting order and enters newOrderId on the same side with
+    // the new price and quantity at the back of its level. Account, time in
+    // force and iceberg display size carry over. Returns the new order, or nullopt if
+    // orderId wasn't resting.
+    optional<Order> replaceOrder(uint64_t orderId, uint64_t newOrderId, uint32_t price, uint32_t quantity,
+                                 chrono::steady_clock::time_point timestamp) {
+        unique_lock<Mutex> lock(mutex_);
+        auto* lookup = orderLookup_.find(orderId);
+        if (!lookup) {
+            return nullopt;
+        }
+        Order replacement = *lookup->second;
+        remove(orderId);
+
+        replacement.orderId = newOrderId;
+        replacement.price = price;
+        replacement.quantity = quantity;
+        replacement.timestamp = timestamp;
+        if (quantity > 0) {
+            insert(replacement);
+        }
+        return replacement;
+    }
+
+    // Replaces an account's quote on one side in place. The quote rests as
+    // a GTC limit order under quoteOrderId(account, side).
+    QuoteUpdate updateQuote(uint32_t account, Side side, uint32_t price, uint32_t quantity,
+                            chrono::steady_clock::time_point timestamp) {
+        unique_lock<Mutex> lock(mutex_);
+        uint64_t orderId = quoteOrderId(account, side);
+        auto* lookup = orderLookup_.find(orderId);
+        if (lookup) {
+            RestingOrder& current = *lookup->second;
+            if (quantity > 0 && current.price == price && quantity <= current.quantity) {
+                dispatchSide(side, [&](auto s) {
+                    reduce<decltype(s)::value>(lookup->first, current, current.quantity - quantity);
+                });
+                return QuoteUpdate::KEPT;
+            }
+            remove(orderId);
+            if (quantity == 0) {
+                return QuoteUpdate::PULLED;
+            }
+        } else if (quantity == 0) {
+            return QuoteUpdate::NONE;
+        }
+
+        Order quote;
+        quote.orderId = orderId;
+        quote.symbol = symbol_;
+        quote.price = price;
+        quote.quantity = quantity;
+        quote.side = side;
+        quote.type = OrderType::LIMIT;
+        quote.timestamp = timestamp;
+        quote.account = account;
+        insert(quote);
+        return QuoteUpdate::REQUEUED;
+    }
+
+    vector<Fill> matchOrders() {
+        unique_lock<Mutex> lock(mutex_);
+        vector<Fill> matches;
+        match(matches);
+        return matches;
+    }
+
+    Price getBestBid() const {
+        shared_lock<Mutex> lock(mutex_);
+        return buyOrders_.empty() ? Price{} : buyOrders_.begin()->first;
+    }
+
+    Price getBestAsk() const {
+        shared_lock<Mutex> lock(mutex_);
+        return sellOrders_.empty() ? Price{} : sellOrders_.begin()->first;
+    }
+
+    // Displayed quantity only; iceberg reserves are not visible
+    uint64_t getVolumeAtPrice(Side side, Price price) const {
+        shared_lock<Mutex> lock(mutex_);
+        return side == Side::BUY ? volumeAt(buyOrders_, price) : volumeAt(sellOrders_, price);
+    }
+
+    // Cancels every resting order of an account, optionally on one side
+    // only, and appends their ids to cancelledIds when given. Walks the
+    // account's intrusive lists, so the cost is proportional to the number
+    // of orders cancelled. Returns that number. Orders without an account
+    // (account 0) are never linked, so there is nothing to cancel for 0.
+    size_t cancelAccountOrders(uint32_t account, optional<Side> side = nullopt,
+                               vector<uint64_t>* cancelledIds = nullptr) {
+        unique_lock<Mutex> lock(mutex_);
+        size_t cancelled = 0;
+        for (Side s : {Side::BUY, Side::SELL}) {
+            if (side && *side != s) {
+                continue;
+            }
+            auto head = accountHeads_.find(accountKey(account, s));
+            RestingOrder* node = head == accountHeads_.end() ? nullptr : head->second;
+            while (node) {
+                RestingOrder* next = node->accountNext;
+                if (cancelledIds) {
+                    cancelledIds->push_back(node->orderId);
+                }
+                remove(node->orderId);
+                ++cancelled;
+                node = next;
+            }
+        }
+        return cancelled;
+    }
+
+    // Cache hints, issued in two stages a round of other work apart so the
+    // second finds what the first fetched. They take no lock: only the
+    // thread that modifies the book may call them.
+
+    // Stage one for any command naming orderId, new or resting: the index
+    // slot it hashes to. Address arithmetic only.
+    void prefetchIndex(uint64_t orderId) const {
+        prefetch(orderLookup_.slotFor(orderId));
+    }
+
+    // Stage two ahead of a cancel, reduce, replace or quote: reads the index
+    // slot and prefetches the resting order node
+    void prefetchOrder(uint64_t orderId) const {
+        if (const auto* lookup = orderLookup_.find(orderId)) {
+            prefetch(&*lookup->second);
+        }
+    }
+
+    // Stage two ahead of adding the order: the level it joins and that
+    // level's last order, which the insert links behind, plus the best
+    // level on the other side, where matching starts. Finding the level
+    // walks the side's tree, whose upper nodes stay cached.
+    void prefetchInsert(const Order& order) const {
+        dispatchSide(order.side, [&](auto side) {
+            constexpr Side S = decltype(side)::value;
+            constexpr Side OTHER = S == Side::BUY ? Side::SELL : Side::BUY;
+            const Levels<S>& own = levels<S>();
+            auto level = own.find(order.price);
+            if (level != own.end()) {
+                prefetch(&*level);
+                if (!level->second.orders.empty()) {
+                    prefetch(&level->second.orders.back());
+                }
+            }
+            const Levels<OTHER>& other = levels<OTHER>();
+            if (!other.empty()) {
+                prefetch(&*other.begin());
+            }
+        });
+    }
+
+    bool isResting(uint64_t orderId) const {
+        shared_lock<Mutex> lock(mutex_);
+        return orderLookup_.find(orderId) != nullptr;
+    }
+
+    // Number of resting orders
+    size_t orderCount() const {
+        shared_lock<Mutex> lock(mutex_);
+        return orderLookup_.size();
+    }
+
+    const string& symbol() const { return symbol_; }
+
+private:
+    template <Side S>
+    using Levels = map<Price, PriceLevel, typename SideTraits<S>::Compare>;
+
+    template <Side S>
+    Levels<S>& levels() {
+        if constexpr (S == Side::BUY) {
+            return buyOrders_;
+        } else {
+            return sellOrders_;
+        }
+    }
+
+    template <Side S>
+    const Levels<S>& levels() const {
+        if constexpr (S == Side::BUY) {
+            return buyOrders_;
+        } else {
+            return sellOrders_;
+        }
+    }
+
+    void insert(const Order& order) {
+        dispatchSide(order.side, [&](auto side) { insert<decltype(side)::value>(order); });
+    }
+
+    template <Side S>
+    void insert(const Order& order) {
+        Price price = order.price;
+        PriceLevel& level = levels<S>()[price];
+        level.orders.emplace_back(order);
+        level.totalQuantity += level.orders.back().quantity;
+        linkAccount(level.orders.back());
+        orderLookup_.set(order.orderId, make_pair(price, prev(level.orders.end())));
+    }
+
+    // Matches while the best bid and ask cross, appending to `matches`
+    void match(vector<Fill>& matches) {
+        auto onFilled = [this](RestingOrder& order) {
+            unlinkAccount(order);
+            orderLookup_.erase(order.orderId);
+        };
+
+        while (!buyOrders_.empty() && !sellOrders_.empty()) {
+            auto buyIt = buyOrders_.begin();
+            auto sellIt = sellOrders_.begin();
+
+            // No overlap, can't match more orders
+            if (buyIt->first < sellIt->first) {
+                break;
+            }
+
+            policy_.matchLevels(buyIt->second, sellIt->second, matches, onFilled);
+
+            if (buyIt->second.orders.empty()) {
+                buyOrders_.erase(buyIt);
+            }
+            if (sellIt->second.orders.empty()) {
+                sellOrders_.erase(sellIt);
+            }
+        }
+    }
+
+    static uint64_t accountKey(uint32_t account, Side side) {
+        return (static_cast<uint64_t>(account) << 1) | (side == Side::SELL ? 1 : 0);
+    }
+
+    void linkAccount(RestingOrder& order) {
+        if (order.account == 0) {
+            return;
+        }
+        RestingOrder*& head = accountHeads_[accountKey(order.account, order.side)];
+        order.accountPrev = nullptr;
+        order.accountNext = head;
+        if (head) {
+            head->accountPrev = &order;
+        }
+        head = &order;
+    }
+
+    void unlinkAccount(RestingOrder& order) {
+        if (order.account == 0) {
+            return;
+        }
+        if (order.accountPrev) {
+            order.accountPrev->accountNext = order.accountNext;
+        } else if (order.accountNext) {
+            accountHeads_[accountKey(order.account, order.side)] = order.accountNext;
+        } else {
+            accountHeads_.erase(accountKey(order.account, order.side));
+        }
+        if (order.accountNext) {
+            order.accountNext->accountPrev = order.accountPrev;
+        }
+    }
+
+    bool remove(uint64_t orderId) {
+        auto* lookup = orderLookup_.find(orderId);
+        if (!lookup) {
+            return false;
+        }
+
+        dispatchSide(lookup->second->side, [&](auto side) {
+            erase<decltype(side)::value>(lookup->first, lookup->second);
+        });
+        orderLookup_.erase(orderId);
+        return true;
+    }
+
+    template <Side S>
+    void erase(Price price, list<RestingOrder>::iterator orderIt) {
+        auto& book = levels<S>();
+        auto priceIt = book.find(price);
+        if (priceIt == book.end()) {
+            return;
+        }
+
+        PriceLevel& level = priceIt->second;
+        level.totalQuantity -= orderIt->quantity;
+        unlinkAccount(*orderIt);
+        level.orders.erase(orderIt);
+
+        // Clean up empty price levels
+        if (level.orders.empty()) {
+            book.erase(priceIt);
+        }
+    }
+
+    template <Side S>
+    void reduce(Price price, RestingOrder& order, uint32_t quantity) {
+        uint32_t hidden = min(quantity, order.reserve);
+        order.reserve -= hidden;
+        quantity -= hidden;
+        auto priceIt = levels<S>().find(price);
+        if (priceIt != levels<S>().end()) {
+            priceIt->second.totalQuantity -= quantity;
+        }
+        order.quantity -= quantity;
+    }
+
+    static void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    template <typename LevelMap>
+    static uint64_t volumeAt(const LevelMap& book, Price price) {
+        auto it = book.find(price);
+        return it == book.end() ? 0 : it->second.totalQuantity;
+    }
+
+    string symbol_;
+    MatchPolicy policy_;
+
+    // Price-time priority: map for price levels, list for time priority
+    Levels<Side::BUY> buyOrders_;    // Higher prices first
+    Levels<Side::SELL> sellOrders_;  // Lower prices first
+
+    // Fast lookup by order ID
+    OrderIndex<pair<Price, list<RestingOrder>::iterator>> orderLookup_;
+
+    // Most recent resting order per (account, side); see RestingOrder
+    unordered_map<uint64_t, RestingOrder*> accountHeads_;
+
+    mutable Mutex mutex_;
+};
+
+} // namespace tme
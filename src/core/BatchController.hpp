@@ -0,0 +1,114 @@
+#pragma once
+
+#include "SeqLock.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace tme {
+
+using namespace std;
+
+// How a BatchController sizes batches. minBatch == maxBatch fixes the size.
+struct BatchingConfig {
+    chrono::nanoseconds latencyTarget{chrono::microseconds(50)};   // Service time allowed per batch
+    size_t minBatch = 1;
+    size_t maxBatch = 1000;
+};
+
+// Snapshot of a BatchController
+struct BatchStats {
+    uint64_t batchSize = 0;     // What the latency target allows with no backlog
+    uint64_t batches = 0;
+    uint64_t items = 0;
+    double itemNanos = 0;       // Smoothed service time per item
+    double batchNanos = 0;      // Smoothed service time per batch
+};
+
+/**
+ * Sizes batches so that serving one stays near a latency target. Every
+ * timed batch updates a smoothed per-item service time, and the next size
+ * is latencyTarget / itemNanos within [minBatch, maxBatch]. When more is
+ * queued than could be served within the target anyway, the target is
+ * already lost for the tail of the queue, so it takes as much of the queue
+ * as maxBatch allows and amortises per-batch costs instead.
+ *
+ * batchSize and record belong to a single thread; configure and stats may
+ * be called from any thread.
+ */
+class BatchController {
+public:
+    explicit BatchController(const BatchingConfig& config = BatchingConfig()) {
+        configure(config);
+    }
+
+    void configure(const BatchingConfig& config) {
+        size_t minBatch = max<size_t>(config.minBatch, 1);
+        latencyTargetNanos_.store(max<int64_t>(config.latencyTarget.count(), 1), memory_order_relaxed);
+        minBatch_.store(minBatch, memory_order_relaxed);
+        maxBatch_.store(max(config.maxBatch, minBatch), memory_order_relaxed);
+    }
+
+    // Size of the next batch with `queued` items waiting
+    size_t batchSize(size_t queued) const {
+        size_t size = targetSize();
+        double target = static_cast<double>(latencyTargetNanos_.load(memory_order_relaxed));
+        if (queued > size && itemNanos_ > 0 && static_cast<double>(queued) * itemNanos_ > target) {
+            size = min(queued, maxBatch_.load(memory_order_relaxed));
+        }
+        return size;
+    }
+
+    // Reports a served batch of `items` that took `elapsed`
+    void record(size_t items, chrono::nanoseconds elapsed) {
+        if (items == 0) {
+            return;
+        }
+        double nanos = static_cast<double>(elapsed.count());
+        double perItem = nanos / static_cast<double>(items);
+        bool first = stats_.batches == 0;
+        itemNanos_ = first ? perItem : itemNanos_ + SMOOTHING * (perItem - itemNanos_);
+        stats_.batchNanos = first ? nanos : stats_.batchNanos + SMOOTHING * (nanos - stats_.batchNanos);
+        stats_.itemNanos = itemNanos_;
+        stats_.batches += 1;
+        stats_.items += items;
+        stats_.batchSize = targetSize();
+        published_.store(stats_);
+    }
+
+    BatchStats stats() const {
+        return published_.load();
+    }
+
+private:
+    // Used until the first batch has been timed
+    static constexpr size_t INITIAL_BATCH = 100;
+    static constexpr double SMOOTHING = 0.125;
+
+    size_t targetSize() const {
+        size_t minBatch = minBatch_.load(memory_order_relaxed);
+        size_t maxBatch = maxBatch_.load(memory_order_relaxed);
+        if (itemNanos_ <= 0) {
+            return clamp(INITIAL_BATCH, minBatch, maxBatch);
+        }
+        double target = static_cast<double>(latencyTargetNanos_.load(memory_order_relaxed));
+        double size = target / itemNanos_;
+        if (size >= static_cast<double>(maxBatch)) {
+            return maxBatch;
+        }
+        return max(static_cast<size_t>(size), minBatch);
+    }
+
+    atomic<int64_t> latencyTargetNanos_{0};
+    atomic<size_t> minBatch_{1};
+    atomic<size_t> maxBatch_{1};
+
+    // Owned by the batching thread
+    double itemNanos_ = 0;
+    BatchStats stats_;
+
+    SeqLock<BatchStats> published_;
+};
+
+} // namespace tme
@@ -0,0 +1,378 @@
+#pragma once
+
+#include "Order.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <shared_mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace tme {
+
+using namespace std;
+
+/**
+ * An order resting in the book. Besides its level's time-priority list an
+ * order with an account is threaded on an intrusive list of the same
+ * account's orders on the same side, so account-wide cancels never scan
+ * the book.
+ *
+ * An iceberg order (displayQuantity below quantity) rests with only its
+ * displayed slice in `quantity`; the rest is held back in `reserve`.
+ */
+struct RestingOrder : Order {
+    RestingOrder(const Order& order) : Order(order) {
+        if (displayQuantity > 0 && displayQuantity < quantity) {
+            reserve = quantity - displayQuantity;
+            quantity = displayQuantity;
+        }
+    }
+
+    uint32_t reserve = 0;
+    RestingOrder* accountPrev = nullptr;
+    RestingOrder* accountNext = nullptr;
+};
+
+/**
+ * A single price level: resting orders in time priority plus a cached
+ * total of their displayed quantity, so volume queries don't have to walk
+ * the list.
+ */
+struct PriceLevel {
+    list<RestingOrder> orders;
+    uint64_t totalQuantity = 0;
+
+    // Shows the next slice of a filled iceberg order from its reserve and
+    // adds it to the level total. Requeueing the node behind the level is
+    // left to the caller, which splices it without reallocating. Returns
+    // false when there is nothing left to show.
+    bool refill(RestingOrder& order) {
+        if (order.reserve == 0) {
+            return false;
+        }
+        order.quantity = min(order.displayQuantity, order.reserve);
+        order.reserve -= order.quantity;
+        totalQuantity += order.quantity;
+        return true;
+    }
+};
+
+// Compile-time description of each side of the book. Bids are kept with
+// the highest price first, asks with the lowest price first.
+template <Side S>
+struct SideTraits;
+
+template <>
+struct SideTraits<Side::BUY> {
+    using Compare = greater<uint32_t>;
+};
+
+template <>
+struct SideTraits<Side::SELL> {
+    using Compare = less<uint32_t>;
+};
+
+// Calls f(integral_constant<Side, S>()) for the runtime side, so a call site
+// picks its per-side template with this one branch
+template <typename F>
+decltype(auto) dispatchSide(Side side, F&& f) {
+    if (side == Side::BUY) {
+        return f(integral_constant<Side, Side::BUY>());
+    }
+    return f(integral_constant<Side, Side::SELL>());
+}
+
+// ---------------------------------------------------------------------------
+// Locking policies
+// ---------------------------------------------------------------------------
+
+// For books that are only ever touched by a single writer thread. All lock
+// operations compile away.
+struct NoLocking {
+    struct Mutex {
+        void lock() {}
+        void unlock() {}
+        bool try_lock() { return true; }
+        void lock_shared() {}
+        void unlock_shared() {}
+        bool try_lock_shared() { return true; }
+    };
+};
+
+// Readers share, writers are exclusive.
+struct SharedMutexLocking {
+    using Mutex = shared_mutex;
+};
+
+// ---------------------------------------------------------------------------
+// Matching policies
+// ---------------------------------------------------------------------------
+
+// One execution between a buy and a sell order. The orders are copied as
+// they were just before the execution.
+struct Fill {
+    Order buy;
+    Order sell;
+    uint32_t price;
+    uint32_t quantity;
+};
+
+// The order that arrived first sets the execution price.
+inline bool arrivedBefore(const Order& a, const Order& b) {
+    if (a.timestamp != b.timestamp) {
+        return a.timestamp < b.timestamp;
+    }
+    return a.orderId < b.orderId;
+}
+
+/**
+ * Strict price-time priority: the oldest order at the best bid is matched
+ * against the oldest order at the best ask until one of the two levels is
+ * exhausted.
+ */
+struct FifoMatching {
+    // Matches two crossing levels. onFilled is invoked for every order that
+    // is fully executed, just before it is removed from its level.
+    template <typename OnFilled>
+    void matchLevels(PriceLevel& bids, PriceLevel& asks,
+                     vector<Fill>& fills, OnFilled&& onFilled) {
+        while (!bids.orders.empty() && !asks.orders.empty()) {
+            RestingOrder& buyOrder = bids.orders.front();
+            RestingOrder& sellOrder = asks.orders.front();
+
+            uint32_t matchedQuantity = min(buyOrder.quantity, sellOrder.quantity);
+            uint32_t price = arrivedBefore(sellOrder, buyOrder) ? sellOrder.price : buyOrder.price;
+            fills.push_back(Fill{buyOrder, sellOrder, price, matchedQuantity});
+
+            buyOrder.quantity -= matchedQuantity;
+            sellOrder.quantity -= matchedQuantity;
+            bids.totalQuantity -= matchedQuantity;
+            asks.totalQuantity -= matchedQuantity;
+
+            if (buyOrder.quantity == 0) {
+                requeueOrRemove(bids, onFilled);
+            }
+            if (sellOrder.quantity == 0) {
+                requeueOrRemove(asks, onFilled);
+            }
+        }
+    }
+
+private:
+    // The filled front order either shows its next iceberg slice at the
+    // back of the level or leaves it
+    template <typename OnFilled>
+    static void requeueOrRemove(PriceLevel& level, OnFilled& onFilled) {
+        if (level.refill(level.orders.front())) {
+            level.orders.splice(level.orders.end(), level.orders, level.orders.begin());
+        } else {
+            onFilled(level.orders.front());
+            level.orders.pop_front();
+        }
+    }
+};
+
+/**
+ * Shared machinery for policies that split a crossing volume across a whole
+ * resting level instead of walking it front to back.
+ *
+ * When two levels cross, the level whose oldest order arrived first is the
+ * resting queue and the other level aggresses against it. The crossing
+ * volume is the smaller of the two totals; aggressing orders take it in
+ * time order and Derived::allocate decides how much of it each resting
+ * order receives. The engine adds and matches one order at a time, so there
+ * the aggressor is always the single new order; a batch added with
+ * addOrdersBatch can cross two deep levels and is allocated the same way. Allocations are computed over contiguous scratch arrays
+ * reused between calls, so a level costs one gather, one allocation pass
+ * and one apply pass regardless of how many fills it produces.
+ */
+template <typename Derived>
+class LevelAllocationMatching {
+public:
+    template <typename OnFilled>
+    void matchLevels(PriceLevel& bids, PriceLevel& asks,
+                     vector<Fill>& fills, OnFilled&& onFilled) {
+        bool bidsRest = arrivedBefore(bids.orders.front(), asks.orders.front());
+        PriceLevel& resting = bidsRest ? bids : asks;
+        PriceLevel& aggressing = bidsRest ? asks : bids;
+        uint64_t volume = min(aggressing.totalQuantity, resting.totalQuantity);
+
+        // Gather the resting queue into contiguous arrays
+        size_t count = resting.orders.size();
+        quantities_.resize(count);
+        allocations_.resize(count);
+        size_t i = 0;
+        for (const Order& order : resting.orders) {
+            quantities_[i++] = order.quantity;
+        }
+
+        static_cast<Derived*>(this)->allocate(resting, volume, quantities_.data(),
+                                              allocations_.data(), count);
+
+        // Pair aggressing orders (time priority) with the resting allocations
+        // until the volume runs out; the aggressor it runs out on keeps its
+        // remainder and priority. Aggressing icebergs that show a new slice
+        // are parked and requeued once the pass is over, so the pass never
+        // sees them again.
+        aggressing.totalQuantity -= volume;
+        resting.totalQuantity -= volume;
+        refilled_.clear();
+        auto restIt = resting.orders.begin();
+        size_t restIdx = 0;
+        uint32_t restLeft = count ? allocations_[0] : 0;
+        for (auto aggIt = aggressing.orders.begin(); aggIt != aggressing.orders.end() && restIdx < count;) {
+            RestingOrder& aggressor = *aggIt;
+            while (aggressor.quantity > 0 && restIdx < count) {
+                if (restLeft == 0) {
+                    ++restIt;
+                    restLeft = ++restIdx < count ? allocations_[restIdx] : 0;
+                    continue;
+                }
+                RestingOrder& passive = *restIt;
+                uint32_t qty = min(aggressor.quantity, restLeft);
+                const Order& buy = bidsRest ? passive : aggressor;
+                const Order& sell = bidsRest ? aggressor : passive;
+                // Whichever order arrived first sets the price, as in FifoMatching
+                uint32_t price = arrivedBefore(passive, aggressor) ? passive.price : aggressor.price;
+                fills.push_back(Fill{buy, sell, price, qty});
+                aggressor.quantity -= qty;
+                passive.quantity -= qty;
+                restLeft -= qty;
+            }
+            if (aggressor.quantity > 0) {
+                break;
+            }
+            if (aggressing.refill(aggressor)) {
+                refilled_.splice(refilled_.end(), aggressing.orders, aggIt++);
+            } else {
+                onFilled(aggressor);
+                aggIt = aggressing.orders.erase(aggIt);
+            }
+        }
+        aggressing.orders.splice(aggressing.orders.end(), refilled_);
+
+        // Drop fully executed resting orders; icebergs go to the back of the
+        // level with their next slice, after the orders not yet visited
+        for (auto it = resting.orders.begin(); it != resting.orders.end();) {
+            auto next = std::next(it);
+            if (it->quantity == 0) {
+                if (resting.refill(*it)) {
+                    resting.orders.splice(resting.orders.end(), resting.orders, it);
+                } else {
+                    onFilled(*it);
+                    resting.orders.erase(it);
+                }
+            }
+            it = next;
+        }
+    }
+
+protected:
+    // Hands out whatever floor division left over one lot at a time in time
+    // priority, so remainders always go to the same orders for the same book.
+    static void distributeRemainder(uint64_t remainder, const uint32_t* quantities,
+                                    uint32_t* allocations, size_t count) {
+        while (remainder > 0) {
+            uint64_t before = remainder;
+            for (size_t i = 0; i < count && remainder > 0; ++i) {
+                if (allocations[i] < quantities[i]) {
+                    ++allocations[i];
+                    --remainder;
+                }
+            }
+            if (remainder == before) {
+                break;
+            }
+        }
+    }
+
+private:
+    vector<uint32_t> quantities_;
+    vector<uint32_t> allocations_;
+    list<RestingOrder> refilled_;
+};
+
+/**
+ * Pro-rata: each resting order receives volume * quantity / levelTotal,
+ * rounded down, with the remainder handed out in time priority.
+ */
+class ProRataMatching : public LevelAllocationMatching<ProRataMatching> {
+public:
+    void allocate(const PriceLevel& resting, uint64_t volume, const uint32_t* quantities,
+                  uint32_t* allocations, size_t count) {
+        if (resting.totalQuantity == 0) {
+            fill(allocations, allocations + count, 0u);
+            return;
+        }
+
+        // A single multiply per order instead of a 64-bit division keeps this
+        // loop vectorisable. The ratio is exact to ~2^-53, so the truncation
+        // can only overshoot the exact floor on values within an ulp of an
+        // integer; the clamp and the correction below absorb that.
+        const double ratio = static_cast<double>(volume) / static_cast<double>(resting.totalQuantity);
+        uint64_t allocated = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t share = static_cast<uint32_t>(quantities[i] * ratio);
+            allocations[i] = share < quantities[i] ? share : quantities[i];
+            allocated += allocations[i];
+        }
+
+        for (size_t i = count; allocated > volume && i-- > 0;) {
+            uint64_t excess = min<uint64_t>(allocated - volume, allocations[i]);
+            allocations[i] -= static_cast<uint32_t>(excess);
+            allocated -= excess;
+        }
+
+        distributeRemainder(volume - allocated, quantities, allocations, count);
+    }
+};
+
+/**
+ * FIFO with a lead market maker: orders from the LMM account first receive
+ * up to lmmPercent of the crossing volume (in time priority among
+ * themselves), then the rest of the level is filled strictly FIFO.
+ */
+class FifoLmmMatching : public LevelAllocationMatching<FifoLmmMatching> {
+public:
+    // Account 0 marks orders without an account, so it can't hold a share
+    FifoLmmMatching(uint32_t lmmAccount = 0, uint32_t lmmPercent = 0)
+        : lmmAccount_(lmmAccount), lmmPercent_(min<uint32_t>(lmmPercent, 100)) {
+        if (lmmAccount_ == 0 && lmmPercent_ > 0) {
+            throw invalid_argument("a lead market maker share needs a non-zero lmmAccount");
+        }
+    }
+
+    void allocate(const PriceLevel& resting, uint64_t volume, const uint32_t* quantities,
+                  uint32_t* allocations, size_t count) {
+        fill(allocations, allocations + count, 0u);
+
+        uint64_t lmmShare = volume * lmmPercent_ / 100;
+        size_t i = 0;
+        for (auto it = resting.orders.begin(); i < count && lmmShare > 0; ++it, ++i) {
+            if (it->account == lmmAccount_) {
+                uint32_t qty = static_cast<uint32_t>(min<uint64_t>(quantities[i], lmmShare));
+                allocations[i] = qty;
+                lmmShare -= qty;
+            }
+        }
+
+        uint64_t remaining = volume;
+        for (size_t j = 0; j < count; ++j) {
+            remaining -= allocations[j];
+        }
+        for (size_t j = 0; j < count && remaining > 0; ++j) {
+            uint32_t qty = static_cast<uint32_t>(min<uint64_t>(quantities[j] - allocations[j], remaining));
+            allocations[j] += qty;
+            remaining -= qty;
+        }
+    }
+
+private:
+    uint32_t lmmAccount_;
+    uint32_t lmmPercent_;
+};
+
+} // namespace tme
@@ -1,12 +1,41 @@
 #pragma once
 
 #include "Order.hpp"
+#include <optional>
 #include <variant>
+#include <vector>
 
 namespace tme {
         // Add new types of actions as needed. 
         struct NewOrder {Order order; };
+        struct CancelOrder {uint64_t orderId; string symbol; };
+        // Cancels an account's resting orders. An empty symbol covers every
+        // instrument; a side restricts it to bids or asks.
+        struct MassCancel {uint32_t account; string symbol; optional<Side> side; };
+        // Takes quantity off a resting order in place (partial cancel or an
+        // execution reported by an external feed); priority is kept.
+        struct ReduceOrder {uint64_t orderId; string symbol; uint32_t quantity; };
+        // Cancel/replace: the order leaves the book and newOrderId enters on
+        // the same side at the back of its level.
+        struct ReplaceOrder {uint64_t orderId; uint64_t newOrderId; string symbol; uint32_t price; uint32_t quantity;
+                             chrono::steady_clock::time_point timestamp; };
+        // An account's two-sided quote on one instrument, replacing its
+        // previous one. A side keeps its priority when only its size goes
+        // down; a zero quantity pulls it. Quotes rest under quoteOrderId.
+        struct Quote {uint32_t account; string symbol; uint32_t bidPrice; uint32_t bidQuantity;
+                      uint32_t askPrice; uint32_t askQuantity; chrono::steady_clock::time_point timestamp; };
+        // Quotes on many instruments, dispatched to the shards as one unit
+        struct MassQuote {vector<Quote> quotes; };
+
+        // The single response to a MassQuote, counted over both sides of
+        // every quote
+        struct MassQuoteAck {
+            uint32_t quotes = 0;
+            uint32_t sidesKept = 0;         // Unchanged or reduced, priority kept
+            uint32_t sidesRequeued = 0;     // Entered at the back of their level
+            uint32_t sidesPulled = 0;       // Zero quantity removed a resting side
+        };
 
         // Add new actions here as required.
-        using Command = variant<NewOrder>;
+        using Command = variant<NewOrder, CancelOrder, MassCancel, ReduceOrder, ReplaceOrder, Quote, MassQuote>;
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "CommandBatcher.hpp"
+#include <chrono>
+#include <utility>
+
+namespace tme {
+
+using namespace std;
+
+CommandBatcher::CommandBatcher(MatchingEngine& engine, const BatchingConfig& config, AppliedCallback onApplied)
+    : engine_(engine), onApplied_(move(onApplied)), batching_(config), drainer_([this] { drain(); }) {}
+
+CommandBatcher::~CommandBatcher() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queued_.notify_one();
+    drainer_.join();
+}
+
+void CommandBatcher::submit(const Command& cmd) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        queue_.push_back(cmd);
+        ++submitted_;
+    }
+    queued_.notify_one();
+}
+
+void CommandBatcher::submit(const vector<Command>& commands) {
+    if (commands.empty()) {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(mutex_);
+        queue_.insert(queue_.end(), commands.begin(), commands.end());
+        submitted_ += commands.size();
+    }
+    queued_.notify_one();
+}
+
+void CommandBatcher::flush() {
+    unique_lock<mutex> lock(mutex_);
+    uint64_t target = submitted_;
+    applied_.wait(lock, [&] { return appliedCount_ >= target; });
+    if (failure_) {
+        rethrow_exception(exchange(failure_, nullptr));
+    }
+}
+
+void CommandBatcher::drain() {
+    vector<Command> batch;
+    for (;;) {
+        {
+            unique_lock<mutex> lock(mutex_);
+            queued_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;     // Stopping with nothing left to apply
+            }
+            size_t size = min(queue_.size(), batching_.batchSize(queue_.size()));
+            batch.assign(queue_.begin(), queue_.begin() + size);
+            queue_.erase(queue_.begin(), queue_.begin() + size);
+        }
+
+        exception_ptr failure;
+        try {
+            auto start = chrono::steady_clock::now();
+            engine_.processBatch(batch);
+            batching_.record(batch.size(), chrono::steady_clock::now() - start);
+            if (onApplied_) {
+                onApplied_(batch);
+            }
+        } catch (...) {
+            failure = current_exception();
+        }
+
+        {
+            lock_guard<mutex> lock(mutex_);
+            appliedCount_ += batch.size();
+            if (failure && !failure_) {
+                failure_ = failure;
+            }
+        }
+        applied_.notify_all();
+    }
+}
+
+} // namespace tme
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "BatchController.hpp"
+#include "MatchingEngine.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tme {
+
+using namespace std;
+
+/**
+ * Admission stage in front of MatchingEngine::processBatch. Any thread may
+ * submit commands; one drain thread hands them to the engine in arrival
+ * order, in batches sized by a BatchController from the measured
+ * processBatch time and the queue behind it. A lightly loaded engine gets
+ * small batches and low latency, a backlogged one large batches that
+ * amortise the per-batch dispatch. Batch boundaries never change fills.
+ */
+class CommandBatcher {
+public:
+    // Called on the drain thread after each batch has been applied
+    using AppliedCallback = function<void(const vector<Command>&)>;
+
+    explicit CommandBatcher(MatchingEngine& engine, const BatchingConfig& config = BatchingConfig(),
+                            AppliedCallback onApplied = nullptr);
+
+    // Applies whatever was submitted, then stops the drain thread
+    ~CommandBatcher();
+
+    CommandBatcher(const CommandBatcher&) = delete;
+    CommandBatcher& operator=(const CommandBatcher&) = delete;
+
+    void submit(const Command& cmd);
+    void submit(const vector<Command>& commands);
+
+    // Blocks until every command submitted so far has been applied, then
+    // rethrows the first processBatch failure since the last flush
+    void flush();
+
+    void setBatching(const BatchingConfig& config) { batching_.configure(config); }
+
+    // Current batch size and processBatch service times
+    BatchStats batchStats() const { return batching_.stats(); }
+
+private:
+    void drain();
+
+    MatchingEngine& engine_;
+    AppliedCallback onApplied_;
+    BatchController batching_;
+
+    mutex mutex_;
+    condition_variable queued_;
+    condition_variable applied_;
+    deque<Command> queue_;
+    uint64_t submitted_ = 0;
+    uint64_t appliedCount_ = 0;
+    bool stopping_ = false;
+    exception_ptr failure_;
+
+    thread drainer_;
+};
+
+} // namespace tme
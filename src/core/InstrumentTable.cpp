@@ -0,0 +1,28 @@
+#include "InstrumentTable.hpp"
+
+namespace tme {
+
+using namespace std;
+
+Instrument* InstrumentTable::find(string_view symbol) {
+    auto it = ids_.find(symbol);
+    return it == ids_.end() ? nullptr : &(*this)[it->second];
+}
+
+Instrument& InstrumentTable::add(const string& symbol, const BookConfig& config, uint32_t shard) {
+    if ((size_ & CHUNK_MASK) == 0) {
+        chunks_.push_back(make_unique<Instrument[]>(CHUNK_SIZE));
+    }
+
+    uint32_t id = static_cast<uint32_t>(size_++);
+    Instrument& instrument = (*this)[id];
+    instrument.id = id;
+    instrument.shard = shard;
+    instrument.symbol = symbol;
+    instrument.config = config;
+
+    ids_.emplace(instrument.symbol, id);
+    return instrument;
+}
+
+} // namespace tme
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "OrderBook.hpp"
+#include "Command.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace tme {
+
+using namespace std;
+
+/**
+ * Everything the engine keeps per instrument. An instrument without resting
+ * orders is compact: it holds no OrderBook at all, only its symbol and
+ * policies. The owning shard promotes it to a full book on its first order
+ * and may drop the book again once it is empty (see
+ * MatchingEngine::compactIdleBooks). There is no compact form for a book
+ * with a few orders: even one stale resting order keeps the full book,
+ * because readers, expiry timers and mass cancels all reach resting orders
+ * through it.
+ */
+struct Instrument {
+    uint32_t id = 0;
+    uint32_t shard = 0;
+    string symbol;
+    BookConfig config;
+
+    // Null while compact. Published with atomic_store/atomic_load because
+    // the shard worker creates it while other threads may be reading.
+    shared_ptr<OrderBook> book;
+
+    // Commands of the batch currently in flight, filled by processBatch and
+    // consumed by the owning shard
+    vector<Command> pending;
+};
+
+/**
+ * Flat table of instruments indexed by a dense id. Entries live in
+ * fixed-size chunks so their addresses never change as the table grows,
+ * and the symbol index keys on views of the entries' own symbols.
+ *
+ * Not thread-safe; MatchingEngine guards it with its instruments mutex.
+ */
+class InstrumentTable {
+public:
+    InstrumentTable() = default;
+    InstrumentTable(const InstrumentTable&) = delete;
+    InstrumentTable& operator=(const InstrumentTable&) = delete;
+
+    // Returns nullptr if the symbol was never seen
+    Instrument* find(string_view symbol);
+
+    // Appends a new compact instrument; the symbol must not exist yet
+    Instrument& add(const string& symbol, const BookConfig& config, uint32_t shard);
+
+    Instrument& operator[](uint32_t id) {
+        return chunks_[id >> CHUNK_BITS][id & CHUNK_MASK];
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    static constexpr size_t CHUNK_BITS = 8;
+    static constexpr size_t CHUNK_SIZE = size_t{1} << CHUNK_BITS;
+    static constexpr size_t CHUNK_MASK = CHUNK_SIZE - 1;
+
+    unordered_map<string_view, uint32_t> ids_;
+    vector<unique_ptr<Instrument[]>> chunks_;
+    size_t size_ = 0;
+};
+
+} // namespace tme
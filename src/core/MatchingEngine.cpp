@@ -7,7 +7,75 @@ namespace tme
 
     using namespace std;
 
-    MatchingEngine::MatchingEngine(size_t numThreads) : shutdown_(false) {
+    namespace
+    {
+        // Idle workers with pending expiries wake up this often to sweep them
+        constexpr chrono::milliseconds EXPIRY_SWEEP_INTERVAL{10};
+
+        constexpr uint64_t NEVER = UINT64_MAX;
+
+        // Pending buffers larger than this are released after each batch
+        // rather than kept around on mostly idle instruments
+        constexpr size_t PENDING_RETAIN_CAPACITY = 256;
+
+        // New orders are added and matched in runs of at most this many
+        constexpr size_t MATCH_BATCH_SIZE = 100;
+
+        const string NO_SYMBOL;
+
+        // The instrument a command applies to; empty for engine-wide ones
+        const string &commandSymbol(const Command &cmd)
+        {
+            return visit([](const auto &c) -> const string & {
+                using T = decay_t<decltype(c)>;
+                if constexpr (is_same_v<T, NewOrder>)
+                {
+                    return c.order.symbol;
+                }
+                else if constexpr (is_same_v<T, MassQuote>)
+                {
+                    return NO_SYMBOL;
+                }
+                else
+                {
+                    return c.symbol;
+                }
+            }, cmd);
+        }
+
+        // Client ids in the quote range would alias a quote in the book's
+        // index, and a quote needs an account to be found again
+        bool isAdmissible(const Command &cmd)
+        {
+            return visit([](const auto &c) {
+                using T = decay_t<decltype(c)>;
+                if constexpr (is_same_v<T, NewOrder>)
+                {
+                    return !isQuoteOrderId(c.order.orderId);
+                }
+                else if constexpr (is_same_v<T, CancelOrder> || is_same_v<T, ReduceOrder>)
+                {
+                    return !isQuoteOrderId(c.orderId);
+                }
+                else if constexpr (is_same_v<T, ReplaceOrder>)
+                {
+                    return !isQuoteOrderId(c.orderId) && !isQuoteOrderId(c.newOrderId);
+                }
+                else if constexpr (is_same_v<T, Quote>)
+                {
+                    return c.account != 0;
+                }
+                else
+                {
+                    return true;
+                }
+            }, cmd);
+        }
+    } // namespace
+
+    MatchingEngine::MatchingEngine(size_t numThreads, const BookConfig& defaultBookConfig)
+        : defaultBookConfig_(defaultBookConfig), positions_(max<size_t>(numThreads, 1)), shutdown_(false),
+          epoch_(chrono::steady_clock::now()), sessionCloseTick_(NEVER) {
         initializeThreadPool(numThreads);
     }
 
@@ -16,175 +84,754 @@ namespace tme
     }
 
     void MatchingEngine::initializeThreadPool(size_t numThreads) {
+        numThreads = max<size_t>(numThreads, 1);
         for (size_t i = 0; i < numThreads; ++i) {
-            workers_.emplace_back(&MatchingEngine::workerThread, this);
+            shards_.push_back(make_unique<Shard>());
         }
+        for (auto& shard : shards_) {
+            shard->worker = thread(&MatchingEngine::workerThread, this, ref(*shard));
+        }
+        batchInstruments_.resize(shards_.size());
     }
 
     void MatchingEngine::shutdownThreadPool() {
-        {
-            lock_guard<mutex> lock(taskMutex_);
-            shutdown_ = true;
+        shutdown_ = true;
+
+        for (auto& shard : shards_) {
+            {
+                lock_guard<mutex> lock(shard->taskMutex);
+            }
+            shard->taskCondition.notify_all();
         }
-        
-        taskCondition_.notify_all();
-        
-        for (thread& worker : workers_) {
-            if (worker.joinable()) {
-                worker.join();
+
+        for (auto& shard : shards_) {
+            if (shard->worker.joinable()) {
+                shard->worker.join();
             }
         }
     }
 
-    void MatchingEngine::workerThread() {
+    void MatchingEngine::workerThread(Shard& shard) {
         while (true) {
             Task task;
-            
+            bool haveTask = false;
+
             {
-                unique_lock<mutex> lock(taskMutex_);
-                taskCondition_.wait(lock, [this] { return !tasks_.empty() || shutdown_; });
-                
-                if (shutdown_ && tasks_.empty()) {
+                unique_lock<mutex> lock(shard.taskMutex);
+                auto ready = [this, &shard] { return !shard.tasks.empty() || shutdown_; };
+                if (shard.expiries.empty() || sequencedExpiry_) {
+                    shard.taskCondition.wait(lock, ready);
+                } else {
+                    shard.taskCondition.wait_for(lock, EXPIRY_SWEEP_INTERVAL, ready);
+                }
+
+                if (shutdown_ && shard.tasks.empty()) {
                     break;
                 }
-                
-                if (!tasks_.empty()) {
-                    task = move(tasks_.front());
-                    tasks_.pop();
+
+                if (!shard.tasks.empty()) {
+                    task = move(shard.tasks.front());
+                    shard.tasks.pop();
+                    haveTask = true;
                 }
             }
-            
-            if (!task.symbol.empty()) {
-                try {
-                    processSymbolOrders(task.symbol, task.orders);
-                    // Signal completion via promise
-                    task.completion_promise.set_value();
-                } catch (exception) {
-                    task.completion_promise.set_exception(current_exception());
+
+            if (!haveTask) {
+                if (!sequencedExpiry_) {
+                    expireDueOrders(shard, toTick(chrono::steady_clock::now()));
                 }
+                continue;
+            }
 
+            try {
+                if (task.kind == TaskKind::MASS_CANCEL) {
+                    massCancelOnShard(shard, task.massCancel);
+                }
+                size_t width = interleaveWidth_.load(memory_order_relaxed);
+                if (task.kind == TaskKind::APPLY && width > 1 && task.instruments.size() > 1) {
+                    processInterleaved(shard, task.instruments, width);
+                    task.instruments.clear();
+                }
+                for (Instrument* instrument : task.instruments) {
+                    if (task.kind == TaskKind::COMPACT) {
+                        // Only this worker writes the book, so an empty book stays empty.
+                        // The pending buffer belongs to processBatch and is left alone.
+                        if (instrument->book && instrument->book->orderCount() == 0) {
+                            atomic_store(&instrument->book, shared_ptr<OrderBook>());
+                        }
+                    } else {
+                        processSymbolCommands(shard, *instrument);
+                    }
+                }
+                // Expiries are removed between batches, never in the middle of
+                // one. Sequenced expiry only runs in sweep tasks.
+                uint64_t sweepTick = task.expiryTick;
+                if (!sequencedExpiry_) {
+                    sweepTick = max(sweepTick, toTick(chrono::steady_clock::now()));
+                }
+                expireDueOrders(shard, sweepTick);
+                // Signal completion via promise
+                task.completion_promise.set_value();
+            } catch (...) {
+                task.completion_promise.set_exception(current_exception());
             }
         }
     }
 
     void MatchingEngine::processOrder(const Order &order)
     {
-        auto orderBook = getOrCreateOrderBook(order.symbol);
+        // Routed through the symbol's shard so the book keeps a single writer
+        processBatch({NewOrder{order}});
+    }
 
-        // Add the order to the order book
-        orderBook->addOrder(order);
+    void MatchingEngine::processBatch(const vector<Command> &commands)
+    {
+        lock_guard<mutex> batchLock(batchMutex_);
 
-        // Try to match orders
-        auto matches = orderBook->matchOrders();
+        // Group commands by instrument, keeping each instrument's commands in
+        // submission order, and the instruments by owning shard. A mass
+        // quote is split into its instruments' quotes within the same pass.
+        // An account-wide mass cancel touches every shard, so the commands
+        // before it are applied first and the ones after it wait for it.
+        size_t next = 0;
+        while (next < commands.size())
+        {
+            {
+                lock_guard<mutex> lock(instrumentsMutex_);
+                Instrument *last = nullptr;
+                for (; next < commands.size(); ++next)
+                {
+                    const Command &cmd = commands[next];
+                    if (const auto *massQuote = get_if<MassQuote>(&cmd))
+                    {
+                        enqueueQuotes(*massQuote, last);
+                        continue;
+                    }
+                    const string &symbol = commandSymbol(cmd);
+                    if (symbol.empty() && holds_alternative<MassCancel>(cmd))
+                    {
+                        break;
+                    }
+                    enqueue(symbol, cmd, last);
+                }
+            }
 
-        // Process matches (in a real system, this would notify traders, update positions, etc.)
-        // Left as a placeholder for future implementation
+            runOnShards(batchInstruments_, TaskKind::APPLY);
+
+            if (next < commands.size())
+            {
+                runMassCancel(get<MassCancel>(commands[next++]));
+            }
+        }
     }
 
-    void MatchingEngine::processBatch(const vector<Command> &commands)
+    MassQuoteAck MatchingEngine::processMassQuote(const MassQuote &massQuote)
     {
-        // Group commands by symbol for better performance
-        unordered_map<string, vector<Order>> symbolGroups;
+        lock_guard<mutex> batchLock(batchMutex_);
 
-        // Group orders by symbol
-        for (const Command &cmd : commands)
+        // Workers only count quotes inside APPLY tasks, which are all
+        // submitted under batchMutex_
+        for (auto &shard : shards_)
         {
-            if (holds_alternative<NewOrder>(cmd))
-            {
-                const NewOrder newOrder = get<NewOrder>(cmd);
-                symbolGroups[newOrder.order.symbol].push_back(newOrder.order);
+            shard->quoteCounts = MassQuoteAck();
+        }
+        {
+            lock_guard<mutex> lock(instrumentsMutex_);
+            Instrument *last = nullptr;
+            enqueueQuotes(massQuote, last);
+        }
+        runOnShards(batchInstruments_, TaskKind::APPLY);
+
+        MassQuoteAck ack;
+        for (auto &shard : shards_)
+        {
+            ack.quotes += shard->quoteCounts.quotes;
+            ack.sidesKept += shard->quoteCounts.sidesKept;
+            ack.sidesRequeued += shard->quoteCounts.sidesRequeued;
+            ack.sidesPulled += shard->quoteCounts.sidesPulled;
+        }
+        return ack;
+    }
+
+    void MatchingEngine::enqueue(const string &symbol, const Command &cmd, Instrument *&last)
+    {
+        if (!isAdmissible(cmd))
+        {
+            rejectedCommands_.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        if (!last || last->symbol != symbol)
+        {
+            last = &findOrAddInstrument(symbol);
+        }
+        if (last->pending.empty())
+        {
+            batchInstruments_[last->shard].push_back(last);
+        }
+        last->pending.push_back(cmd);
+    }
+
+    void MatchingEngine::enqueueQuotes(const MassQuote &massQuote, Instrument *&last)
+    {
+        for (const Quote &quote : massQuote.quotes)
+        {
+            enqueue(quote.symbol, quote, last);
+        }
+    }
+
+    void MatchingEngine::expireOrders()
+    {
+        expireOrders(chrono::steady_clock::now());
+    }
+
+    void MatchingEngine::expireOrders(chrono::steady_clock::time_point now)
+    {
+        // A point in the command stream, like a batch
+        lock_guard<mutex> batchLock(batchMutex_);
+        uint64_t tick = toTick(now);
+        if (sequencedExpiry_ && tick > sequencedTick_) {
+            sequencedTick_ = tick;
+        }
+
+        vector<future<void>> futures;
+        futures.reserve(shards_.size());
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            Task task;
+            task.expiryTick = tick;
+            futures.push_back(submit(i, move(task)));
+        }
+        for (auto& future : futures) {
+            future.wait();
+        }
+    }
+
+    void MatchingEngine::compactIdleBooks()
+    {
+        // Ordered with batches, so a COMPACT task never lands between a
+        // batch's enqueue and its APPLY
+        lock_guard<mutex> batchLock(batchMutex_);
+        vector<vector<Instrument*>> candidates(shards_.size());
+        {
+            lock_guard<mutex> lock(instrumentsMutex_);
+            for (uint32_t id = 0; id < instruments_.size(); ++id) {
+                Instrument& instrument = instruments_[id];
+                if (atomic_load(&instrument.book)) {
+                    candidates[instrument.shard].push_back(&instrument);
+                }
+                // Empty between batches; only the retained capacity goes
+                vector<Command>().swap(instrument.pending);
             }
         }
+        runOnShards(candidates, TaskKind::COMPACT);
+    }
+
+    size_t MatchingEngine::instrumentCount()
+    {
+        lock_guard<mutex> lock(instrumentsMutex_);
+        return instruments_.size();
+    }
 
+    void MatchingEngine::runOnShards(vector<vector<Instrument*>> &perShard, TaskKind kind)
+    {
         // Create futures for synchronization
         vector<future<void>> futures;
-        futures.reserve(symbolGroups.size());
-        
-        // Submit tasks to thread pool for parallel processing
-        {
-            lock_guard<mutex> lock(taskMutex_);
-            for (const auto &[symbol, orders] : symbolGroups) {
-                Task task(symbol, orders);
-                futures.push_back(task.completion_promise.get_future());
-                tasks_.push(move(task));
-                taskCondition_.notify_one();
+        futures.reserve(shards_.size());
+
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            if (perShard[i].empty()) {
+                continue;
             }
+            Task task;
+            task.instruments.swap(perShard[i]);
+            task.kind = kind;
+            futures.push_back(submit(i, move(task)));
         }
-        
-        //taskCondition_.notify_all();
-        
+
         // Wait for all tasks to complete using futures
         for (auto& future : futures) {
             future.wait();
         }
     }
 
-    void MatchingEngine::processSymbolOrders(const string& symbol, const vector<Order>& orders) {
-        auto orderBook = getOrCreateOrderBook(symbol);
-        
-        const size_t MATCH_BATCH_SIZE = 100;
-        
-        // Process orders in chunks using bulk insertion
-        for (size_t i = 0; i < orders.size(); i += MATCH_BATCH_SIZE) {
-            size_t endIdx = min(i + MATCH_BATCH_SIZE, orders.size());
-            vector<Order> batch(orders.begin() + i, orders.begin() + endIdx);
-            
-            // Add batch of orders
-            orderBook->addOrdersBatch(batch);
-            
-            // Match after each batch
-            auto matches = orderBook->matchOrders();
-            // Process matches (in a real system, this would notify traders, update positions, etc.)
-            // Left as a placeholder for future implementation
+    void MatchingEngine::setInterleaveWidth(size_t width)
+    {
+        interleaveWidth_ = max<size_t>(width, 1);
+    }
+
+    AccountExposure MatchingEngine::accountExposure(uint32_t account) const
+    {
+        return positions_.exposure(account);
+    }
+
+    Position MatchingEngine::accountPosition(uint32_t account, const string &symbol)
+    {
+        uint32_t instrumentId;
+        {
+            lock_guard<mutex> lock(instrumentsMutex_);
+            Instrument *instrument = instruments_.find(symbol);
+            if (!instrument)
+            {
+                return Position();
+            }
+            instrumentId = instrument->id;
+        }
+        return positions_.position(account, instrumentId);
+    }
+
+    void MatchingEngine::setSessionClose(chrono::steady_clock::time_point sessionClose)
+    {
+        sessionCloseTick_ = toTick(sessionClose);
+    }
+
+    void MatchingEngine::setSequencedExpiry(bool sequenced)
+    {
+        // The sequenced clock starts at the epoch on every engine, not at
+        // whatever time each one switched over
+        lock_guard<mutex> batchLock(batchMutex_);
+        sequencedTick_ = 0;
+        sequencedExpiry_ = sequenced;
+    }
+
+    future<void> MatchingEngine::submit(size_t shardIndex, Task task)
+    {
+        Shard& shard = *shards_[shardIndex];
+        future<void> completion = task.completion_promise.get_future();
+        {
+            lock_guard<mutex> lock(shard.taskMutex);
+            shard.tasks.push(move(task));
         }
+        shard.taskCondition.notify_one();
+        return completion;
     }
 
-    bool MatchingEngine::cancelOrder(uint64_t orderId, const string &symbol)
+    void MatchingEngine::runMassCancel(const MassCancel &massCancel)
+    {
+        vector<future<void>> futures;
+        futures.reserve(shards_.size());
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            Task task;
+            task.kind = TaskKind::MASS_CANCEL;
+            task.massCancel = massCancel;
+            futures.push_back(submit(i, move(task)));
+        }
+        for (auto& future : futures) {
+            future.wait();
+        }
+    }
+
+    void MatchingEngine::massCancelOnShard(Shard& shard, const MassCancel& massCancel) {
+        auto it = shard.accountInstruments.find(massCancel.account);
+        if (it == shard.accountInstruments.end()) {
+            return;
+        }
+
+        for (Instrument* instrument : it->second) {
+            if (instrument->book) {
+                cancelAccountOrders(shard, *instrument->book, massCancel);
+            }
+        }
+
+        // With both sides cancelled the account has nothing left on this shard
+        if (!massCancel.side) {
+            shard.accountInstruments.erase(it);
+        }
+    }
+
+    void MatchingEngine::processSymbolCommands(Shard& shard, Instrument& instrument) {
+        SymbolCursor cursor{&instrument, instrument.book.get(), 0, arrivalTick()};
+        while (stepSymbolCommands(shard, cursor)) {
+        }
+    }
+
+    void MatchingEngine::processInterleaved(Shard& shard, const vector<Instrument*>& instruments, size_t width) {
+        uint64_t nowTick = arrivalTick();
+        vector<SymbolCursor>& active = shard.cursors;
+        active.clear();
+
+        size_t nextInstrument = 0;
+        while (!active.empty() || nextInstrument < instruments.size()) {
+            while (active.size() < width && nextInstrument < instruments.size()) {
+                Instrument* instrument = instruments[nextInstrument++];
+                active.push_back(SymbolCursor{instrument, instrument->book.get(), 0, nowTick});
+                prefetchStepIndex(active.back());
+            }
+
+            // Every step's index slot was prefetched a round ago; follow it
+            // for all books before any of them is touched, so their misses
+            // overlap instead of being paid one after another
+            for (const SymbolCursor& cursor : active) {
+                prefetchSymbolStep(cursor);
+            }
+            for (size_t i = 0; i < active.size();) {
+                if (stepSymbolCommands(shard, active[i])) {
+                    prefetchStepIndex(active[i]);
+                    ++i;
+                } else {
+                    active[i] = active.back();
+                    active.pop_back();
+                }
+            }
+        }
+    }
+
+    void MatchingEngine::prefetchStepIndex(const SymbolCursor& cursor) const {
+        const vector<Command>& commands = cursor.instrument->pending;
+        if (!cursor.book || cursor.next >= commands.size()) {
+            return;
+        }
+        const Command& cmd = commands[cursor.next];
+        if (const auto* newOrder = get_if<NewOrder>(&cmd)) {
+            cursor.book->prefetchIndex(newOrder->order.orderId);
+        } else if (const auto* cancel = get_if<CancelOrder>(&cmd)) {
+            cursor.book->prefetchIndex(cancel->orderId);
+        } else if (const auto* reduce = get_if<ReduceOrder>(&cmd)) {
+            cursor.book->prefetchIndex(reduce->orderId);
+        } else if (const auto* replace = get_if<ReplaceOrder>(&cmd)) {
+            cursor.book->prefetchIndex(replace->orderId);
+        } else if (const auto* quote = get_if<Quote>(&cmd)) {
+            cursor.book->prefetchIndex(quoteOrderId(quote->account, Side::BUY));
+            cursor.book->prefetchIndex(quoteOrderId(quote->account, Side::SELL));
+        }
+    }
+
+    void MatchingEngine::prefetchSymbolStep(const SymbolCursor& cursor) const {
+        const vector<Command>& commands = cursor.instrument->pending;
+        if (!cursor.book || cursor.next >= commands.size()) {
+            return;
+        }
+        const Command& cmd = commands[cursor.next];
+        if (const auto* newOrder = get_if<NewOrder>(&cmd)) {
+            cursor.book->prefetchInsert(newOrder->order);
+        } else if (const auto* cancel = get_if<CancelOrder>(&cmd)) {
+            cursor.book->prefetchOrder(cancel->orderId);
+        } else if (const auto* reduce = get_if<ReduceOrder>(&cmd)) {
+            cursor.book->prefetchOrder(reduce->orderId);
+        } else if (const auto* replace = get_if<ReplaceOrder>(&cmd)) {
+            cursor.book->prefetchOrder(replace->orderId);
+        } else if (const auto* quote = get_if<Quote>(&cmd)) {
+            cursor.book->prefetchOrder(quoteOrderId(quote->account, Side::BUY));
+            cursor.book->prefetchOrder(quoteOrderId(quote->account, Side::SELL));
+        }
+    }
+
+    bool MatchingEngine::stepSymbolCommands(Shard& shard, SymbolCursor& cursor) {
+        Instrument& instrument = *cursor.instrument;
+        const vector<Command>& commands = instrument.pending;
+        vector<Order>& batch = shard.orderBatch;
+        batch.clear();
+
+        // Runs of new orders are inserted in chunks using bulk insertion;
+        // any other command ends the run so ordering is preserved
+        while (cursor.next < commands.size()) {
+            const Command& cmd = commands[cursor.next];
+            if (const auto* newOrder = get_if<NewOrder>(&cmd)) {
+                ++cursor.next;
+                const Order& order = newOrder->order;
+                if (expiryTickFor(order) <= cursor.nowTick) {
+                    continue; // Already expired, never rests
+                }
+
+                promote(cursor);
+                batch.push_back(order);
+                if (batch.size() == MATCH_BATCH_SIZE) {
+                    addAndMatch(shard, instrument, *cursor.book, batch);
+                    return true;
+                }
+                continue;
+            }
+
+            if (!batch.empty()) {
+                addAndMatch(shard, instrument, *cursor.book, batch);
+                return true;
+            }
+
+            ++cursor.next;
+            OrderBook* book = cursor.book;
+            if (const auto* cancel = get_if<CancelOrder>(&cmd)) {
+                if (book && book->cancelOrder(cancel->orderId)) {
+                    ++shard.cancelsApplied;
+                }
+                cancelExpiry(shard, cancel->orderId);
+            } else if (const auto* massCancel = get_if<MassCancel>(&cmd)) {
+                if (book) {
+                    cancelAccountOrders(shard, *book, *massCancel);
+                }
+            } else if (const auto* reduce = get_if<ReduceOrder>(&cmd)) {
+                if (book && book->reduceOrder(reduce->orderId, reduce->quantity) &&
+                    !book->isResting(reduce->orderId)) {
+                    cancelExpiry(shard, reduce->orderId);   // Reduced to nothing
+                }
+            } else if (const auto* replace = get_if<ReplaceOrder>(&cmd)) {
+                if (book) {
+                    replaceAndMatch(shard, instrument, *book, *replace);
+                }
+            } else if (const auto* quote = get_if<Quote>(&cmd)) {
+                ++shard.quoteCounts.quotes;
+                // Pulling a quote from a compact instrument has nothing to do
+                if (book || quote->bidQuantity > 0 || quote->askQuantity > 0) {
+                    quoteAndMatch(shard, instrument, promote(cursor), *quote);
+                }
+            }
+            return true;
+        }
+
+        if (!batch.empty()) {
+            addAndMatch(shard, instrument, *cursor.book, batch);
+        }
+
+        instrument.pending.clear();
+        if (instrument.pending.capacity() > PENDING_RETAIN_CAPACITY) {
+            vector<Command>().swap(instrument.pending);
+        }
+        return false;
+    }
+
+    void MatchingEngine::addAndMatch(Shard& shard, Instrument& instrument, OrderBook& book, const vector<Order>& orders) {
+        // Each order is matched as it is added, so the fills don't depend
+        // on where a run was cut
+        auto matches = book.addAndMatchOrders(orders);
+        positions_.onFills(instrument.shard, instrument.id, matches);
+        cancelFilledExpiries(shard, book, matches);
+
+        uint32_t lastAccount = 0;
+        for (const Order& order : orders) {
+            if (order.account != 0 && order.account != lastAccount) {
+                shard.accountInstruments[order.account].insert(&instrument);
+                lastAccount = order.account;
+            }
+
+            // Only orders left resting after matching need a timer
+            uint64_t expiry = expiryTickFor(order);
+            if (expiry != NEVER && (matches.empty() || book.isResting(order.orderId))) {
+                scheduleExpiry(shard, instrument, order.orderId, expiry);
+            } else if (!shard.expiryHandles.empty()) {
+                cancelExpiry(shard, order.orderId);     // A reused id must not keep the old timer
+            }
+        }
+    }
+
+    void MatchingEngine::replaceAndMatch(Shard& shard, Instrument& instrument, OrderBook& book, const ReplaceOrder& replace) {
+        auto replacement = book.replaceOrder(replace.orderId, replace.newOrderId, replace.price,
+                                             replace.quantity, replace.timestamp);
+        if (!replacement) {
+            return;
+        }
+
+        // A new price may cross the other side
+        auto matches = book.matchOrders();
+        positions_.onFills(instrument.shard, instrument.id, matches);
+        cancelFilledExpiries(shard, book, matches);
+
+        // The expiry moves to the new order id, if it still rests
+        cancelExpiry(shard, replace.orderId);
+        uint64_t expiry = expiryTickFor(*replacement);
+        if (expiry != NEVER && book.isResting(replacement->orderId)) {
+            scheduleExpiry(shard, instrument, replacement->orderId, expiry);
+        } else {
+            cancelExpiry(shard, replacement->orderId);
+        }
+    }
+
+    void MatchingEngine::quoteAndMatch(Shard& shard, Instrument& instrument, OrderBook& book, const Quote& quote) {
+        MassQuoteAck& counts = shard.quoteCounts;
+        for (Side side : {Side::BUY, Side::SELL}) {
+            bool bid = side == Side::BUY;
+            switch (book.updateQuote(quote.account, side, bid ? quote.bidPrice : quote.askPrice,
+                                     bid ? quote.bidQuantity : quote.askQuantity, quote.timestamp)) {
+            case QuoteUpdate::KEPT:
+                ++counts.sidesKept;
+                break;
+            case QuoteUpdate::REQUEUED:
+                ++counts.sidesRequeued;
+                break;
+            case QuoteUpdate::PULLED:
+                ++counts.sidesPulled;
+                break;
+            case QuoteUpdate::NONE:
+                break;
+            }
+        }
+        if (quote.account != 0) {
+            shard.accountInstruments[quote.account].insert(&instrument);
+        }
+
+        // A new quote may cross the other side
+        auto matches = book.matchOrders();
+        positions_.onFills(instrument.shard, instrument.id, matches);
+        cancelFilledExpiries(shard, book, matches);
+    }
+
+    OrderBook& MatchingEngine::promote(SymbolCursor& cursor) {
+        if (!cursor.book) {
+            // First real activity: promote the compact instrument
+            Instrument& instrument = *cursor.instrument;
+            auto created = make_shared<OrderBook>(instrument.symbol, instrument.config);
+            atomic_store(&instrument.book, created);
+            cursor.book = created.get();
+        }
+        return *cursor.book;
+    }
+
+    void MatchingEngine::cancelAccountOrders(Shard& shard, OrderBook& book, const MassCancel& massCancel) {
+        // Ids are only needed to drop expiry timers, if the shard has any
+        if (shard.expiryHandles.empty()) {
+            book.cancelAccountOrders(massCancel.account, massCancel.side);
+            return;
+        }
+        shard.cancelledIds.clear();
+        book.cancelAccountOrders(massCancel.account, massCancel.side, &shard.cancelledIds);
+        for (uint64_t orderId : shard.cancelledIds) {
+            cancelExpiry(shard, orderId);
+        }
+    }
+
+    void MatchingEngine::scheduleExpiry(Shard& shard, Instrument& instrument, uint64_t orderId, uint64_t tick) {
+        auto [it, inserted] = shard.expiryHandles.try_emplace(orderId);
+        if (!inserted) {
+            shard.expiries.cancel(it->second);
+        }
+        it->second = shard.expiries.schedule(tick, Expiry{&instrument, orderId});
+    }
+
+    void MatchingEngine::cancelExpiry(Shard& shard, uint64_t orderId) {
+        auto it = shard.expiryHandles.find(orderId);
+        if (it != shard.expiryHandles.end()) {
+            shard.expiries.cancel(it->second);
+            shard.expiryHandles.erase(it);
+        }
+    }
+
+    void MatchingEngine::cancelFilledExpiries(Shard& shard, const OrderBook& book, const vector<Fill>& fills) {
+        if (shard.expiryHandles.empty()) {
+            return;
+        }
+        for (const Fill& fill : fills) {
+            for (uint64_t orderId : {fill.buy.orderId, fill.sell.orderId}) {
+                if (shard.expiryHandles.count(orderId) && !book.isResting(orderId)) {
+                    cancelExpiry(shard, orderId);
+                }
+            }
+        }
+    }
+
+    void MatchingEngine::expireDueOrders(Shard& shard, uint64_t nowTick) {
+        shard.expiries.advance(nowTick, shard.expired);
+        if (shard.expired.empty()) {
+            return;
+        }
+
+        // One cancelOrdersBatch per book for the whole burst
+        sort(shard.expired.begin(), shard.expired.end(),
+             [](const Expiry& a, const Expiry& b) { return a.instrument->id < b.instrument->id; });
+
+        vector<uint64_t> orderIds;
+        for (size_t i = 0; i < shard.expired.size();) {
+            Instrument* instrument = shard.expired[i].instrument;
+            orderIds.clear();
+            for (; i < shard.expired.size() && shard.expired[i].instrument == instrument; ++i) {
+                orderIds.push_back(shard.expired[i].orderId);
+                shard.expiryHandles.erase(shard.expired[i].orderId);
+            }
+            // A compacted instrument had no resting orders left to expire
+            if (instrument->book) {
+                instrument->book->cancelOrdersBatch(orderIds);
+            }
+        }
+        shard.expired.clear();
+    }
+
+    uint64_t MatchingEngine::expiryTickFor(const Order &order) const
+    {
+        switch (order.timeInForce)
+        {
+        case TimeInForce::DAY:
+            return sessionCloseTick_.load();
+        case TimeInForce::GTD:
+            return toTick(order.expireTime);
+        default:
+            return NEVER;
+        }
+    }
+
+    uint64_t MatchingEngine::arrivalTick() const
+    {
+        return sequencedExpiry_ ? sequencedTick_.load() : toTick(chrono::steady_clock::now());
+    }
+
+    uint64_t MatchingEngine::toTick(chrono::steady_clock::time_point time) const
+    {
+        if (time <= epoch_) {
+            return 0;
+        }
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::milliseconds>(time - epoch_).count());
+    }
+
+    size_t MatchingEngine::shardFor(const string &symbol) const
     {
-        shared_ptr<OrderBook> orderBook;
+        return hash<string>{}(symbol) % shards_.size();
+    }
 
-        // Only lock while accessing the map
+    bool MatchingEngine::cancelOrder(uint64_t orderId, const string &symbol)
+    {
+        // Applied by the owning worker, which keeps single-writer books
+        // single-writer and drops the order's expiry timer with it
+        lock_guard<mutex> batchLock(batchMutex_);
+        Shard *owner = nullptr;
         {
-            lock_guard<mutex> lock(orderBooksMutex_);
-            auto it = orderBooks_.find(symbol);
-            if (it == orderBooks_.end())
+            lock_guard<mutex> lock(instrumentsMutex_);
+            Instrument *instrument = instruments_.find(symbol);
+            if (!instrument || !atomic_load(&instrument->book))
             {
-                return false; // Symbol not found
+                return false; // Symbol not found or no resting orders
             }
-            orderBook = it->second;
+            owner = shards_[instrument->shard].get();
+            Instrument *last = instrument;
+            enqueue(symbol, CancelOrder{orderId, symbol}, last);
         }
 
-        // Now use the thread-safe orderBook outside the lock
-        return orderBook->cancelOrder(orderId);
+        // Workers only count cancels inside APPLY tasks, which are all
+        // submitted under batchMutex_
+        owner->cancelsApplied = 0;
+        runOnShards(batchInstruments_, TaskKind::APPLY);
+        return owner->cancelsApplied > 0;
     }
 
     shared_ptr<OrderBook> MatchingEngine::getOrderBook(const string &symbol)
     {
-        lock_guard<mutex> lock(orderBooksMutex_);
+        lock_guard<mutex> lock(instrumentsMutex_);
 
-        auto it = orderBooks_.find(symbol);
-        if (it == orderBooks_.end())
+        Instrument *instrument = instruments_.find(symbol);
+        if (!instrument || instrument->config.locking == LockingMode::NONE)
         {
-            return nullptr; // Symbol not found
+            return nullptr; // Symbol not found, or a book only its worker may touch
         }
 
-        return it->second;
+        return atomic_load(&instrument->book);
     }
 
-    shared_ptr<OrderBook> MatchingEngine::getOrCreateOrderBook(const string &symbol)
+    bool MatchingEngine::configureInstrument(const string &symbol, const BookConfig &config)
     {
-        lock_guard<mutex> lock(orderBooksMutex_);
+        lock_guard<mutex> lock(instrumentsMutex_);
+
+        if (instruments_.find(symbol))
+        {
+            return false; // Policies are fixed once registered
+        }
 
-        auto it = orderBooks_.find(symbol);
-        if (it == orderBooks_.end())
+        instruments_.add(symbol, config, static_cast<uint32_t>(shardFor(symbol)));
+        return true;
+    }
+
+    Instrument &MatchingEngine::findOrAddInstrument(const string &symbol)
+    {
+        Instrument *instrument = instruments_.find(symbol);
+        if (instrument)
         {
-            // Create new order book for this symbol
-            auto orderBook = make_shared<OrderBook>(symbol);
-            orderBooks_[symbol] = orderBook;
-            return orderBook;
+            return *instrument;
         }
 
-        return it->second;
+        // New instruments start compact with the default policies
+        return instruments_.add(symbol, defaultBookConfig_, static_cast<uint32_t>(shardFor(symbol)));
     }
 
 } // namespace tme
@@ -2,7 +2,11 @@
 
 #include "OrderBook.hpp"
 #include "Command.hpp"
+#include "TimingWheel.hpp"
+#include "InstrumentTable.hpp"
+#include "PositionKeeper.hpp"
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <memory>
 #include <mutex>
@@ -12,6 +16,7 @@
 #include <queue>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 
 namespace tme {
 
@@ -20,80 +25,282 @@ using namespace std;
 /**
  * The main matching engine class that processes orders and maintains
  * order books for different symbols with parallel processing capabilities.
+ *
+ * Every symbol is pinned to one shard, and each shard has a single worker
+ * thread, so all commands for a book are applied by the same thread in
+ * submission order. Per-shard state such as the GTD/DAY expiry wheel is
+ * only ever touched by that worker.
+ *
+ * Instruments live in a flat table and stay compact (no OrderBook) until
+ * their first order, so registering hundreds of thousands of mostly idle
+ * instruments costs little more than their symbols.
+ *
+ * Every fill updates the traders' positions on the shard that produced it;
+ * see PositionKeeper.
  */
 class MatchingEngine {
 public:
-    // Constructor with configurable thread count
-    explicit MatchingEngine(size_t numThreads = 4);
+    // Constructor with configurable thread count and the book policies
+    // used for instruments that were not configured explicitly
+    explicit MatchingEngine(size_t numThreads = 4, const BookConfig& defaultBookConfig = BookConfig());
     ~MatchingEngine();
-    
+
     // Process a new order
     void processOrder(const Order& order);
-    
-    // Process a batch of commands efficiently with parallel processing
+
+    // Process a batch of commands efficiently with parallel processing.
+    // Concurrent calls are serialised. Commands naming a reserved quote
+    // order id (see isQuoteOrderId) and quotes without an account are
+    // dropped and counted in rejectedCommands.
     void processBatch(const vector<Command>& commands);
-    
-    // Cancel an existing order
+
+    // Commands dropped at ingress so far
+    uint64_t rejectedCommands() const { return rejectedCommands_.load(memory_order_relaxed); }
+
+    // Apply a mass quote as one unit, like a batch of its quotes, and
+    // return a single summary of what it did. Concurrent calls are
+    // serialised with processBatch.
+    MassQuoteAck processMassQuote(const MassQuote& massQuote);
+
+    // Cancel an existing order through its shard, like a CancelOrder
+    // command; returns false if it wasn't resting. Serialised with
+    // processBatch.
     bool cancelOrder(uint64_t orderId, const string& symbol);
-    
-    // Get order book for a symbol
+
+    // Get order book for a symbol; nullptr if unknown, compact or
+    // single-writer (LockingMode::NONE), since only the shard's worker may
+    // touch such a book
     shared_ptr<OrderBook> getOrderBook(const string& symbol);
-    
+
+    // Register a symbol with specific book policies. The book itself is only
+    // built on the first order. Returns false if the symbol already exists
+    // (its policies can't change once registered).
+    bool configureInstrument(const string& symbol, const BookConfig& config);
+
+    // Release the books of every instrument without resting orders, turning
+    // them back into compact entries, and wait for it. A book with any
+    // resting order, however few, stays a full book.
+    void compactIdleBooks();
+
+    // Number of known instruments, compact or not
+    size_t instrumentCount();
+
+    // DAY orders expire at this time. Defaults to never.
+    void setSessionClose(chrono::steady_clock::time_point sessionClose);
+
+    // Remove every GTD/DAY order that is due, on all shards, and wait for it.
+    // Workers also do this between batches and while idle.
+    void expireOrders();
+
+    // Remove every GTD/DAY order due at `now`. Serialised with processBatch.
+    void expireOrders(chrono::steady_clock::time_point now);
+
+    // With sequenced expiry the workers never sweep on their own and orders
+    // are only expired by expireOrders(now); the last such `now` is also the
+    // clock arriving orders are checked against. Two engines fed the same
+    // commands and expireOrders calls then expire the same orders at the
+    // same point, whatever their own clocks say. Off by default.
+    void setSequencedExpiry(bool sequenced);
+
+    // Expiry times are measured from here. Replicas exchange times as
+    // offsets from their own epoch.
+    chrono::steady_clock::time_point epoch() const { return epoch_; }
+
+    // How many books a worker advances in lockstep within one batch. With
+    // more than one, the misses of each book's next step are overlapped
+    // with the other books' work: its index slot is prefetched one round
+    // ahead, and the order node or insert level it leads to at the start
+    // of the round that applies the step.
+    // 1 (the default) applies one instrument after another.
+    void setInterleaveWidth(size_t width);
+
+    // Net/gross notional, realized P&L and traded volume of an account,
+    // built from every fill so far. Lock-free; callable from any thread.
+    AccountExposure accountExposure(uint32_t account) const;
+
+    // An account's position in one instrument, as of its last fill there.
+    // Callable from any thread; the symbol is resolved under the instruments
+    // mutex, the position itself is read without a lock.
+    Position accountPosition(uint32_t account, const string& symbol);
+
 private:
-    // Task structure for thread pool with promise/future support
+    enum class TaskKind {
+        APPLY,          // Apply the instruments' pending commands
+        COMPACT,        // Release the instruments' books if they are empty
+        MASS_CANCEL     // Run massCancel on every book the account rests in
+    };
+
+    // Work for one shard. An APPLY task without instruments only runs the
+    // shard's expiry sweep, up to expiryTick.
     struct Task {
-        string symbol;
-        vector<Order> orders;
+        TaskKind kind = TaskKind::APPLY;
+        vector<Instrument*> instruments;
+        MassCancel massCancel;
+        uint64_t expiryTick = 0;
         promise<void> completion_promise;
-        
-        Task() = default;
-        Task(const string& sym, const vector<Order>& ord) : symbol(sym), orders(ord) {}
-        
-        // Move constructor and assignment
-        Task(Task&& other) noexcept 
-            : symbol(move(other.symbol)), 
-              orders(move(other.orders)), 
-              completion_promise(move(other.completion_promise)) {}
-        
-        Task& operator=(Task&& other) noexcept {
-            if (this != &other) {
-                symbol = move(other.symbol);
-                orders = move(other.orders);
-                completion_promise = move(other.completion_promise);
-            }
-            return *this;
-        }
-        
-        // Delete copy constructor and assignment
-        Task(const Task&) = delete;
-        Task& operator=(const Task&) = delete;
     };
-    
-    // Map of symbol to order book
-    unordered_map<string, shared_ptr<OrderBook>> orderBooks_;
-    
-    // Thread pool management
-    vector<thread> workers_;
-    queue<Task> tasks_;
-    mutex taskMutex_;
-    condition_variable taskCondition_;
+
+    // Progress through one instrument's pending commands
+    struct SymbolCursor {
+        Instrument* instrument;
+        OrderBook* book;        // Null until the instrument is promoted
+        size_t next;            // Next pending command to apply
+        uint64_t nowTick;       // Orders expiring at or before this never rest
+    };
+
+    // Resting order that can expire, as recorded in a shard's wheel
+    struct Expiry {
+        Instrument* instrument;
+        uint64_t orderId;
+    };
+
+    struct Shard {
+        // Task queue, shared with the submitting thread
+        queue<Task> tasks;
+        mutex taskMutex;
+        condition_variable taskCondition;
+        thread worker;
+
+        // Only touched by the worker
+        TimingWheel<Expiry> expiries;
+        unordered_map<uint64_t, TimingWheel<Expiry>::Handle> expiryHandles;
+        vector<Expiry> expired;
+
+        // Scratch for applying commands
+        vector<Order> orderBatch;
+        vector<SymbolCursor> cursors;
+        vector<uint64_t> cancelledIds;
+
+        // Quotes applied since processMassQuote last reset them
+        MassQuoteAck quoteCounts;
+
+        // Cancel commands that found their order since cancelOrder last
+        // reset it
+        size_t cancelsApplied = 0;
+
+        // Instruments each account has had orders in, for account-wide mass
+        // cancels. Pruned when such a cancel runs; account 0 isn't tracked.
+        unordered_map<uint32_t, unordered_set<Instrument*>> accountInstruments;
+    };
+
+    // Every instrument the engine has seen, indexed by symbol and dense id
+    InstrumentTable instruments_;
+
+    // Policies for books created on first use
+    BookConfig defaultBookConfig_;
+
+    // Positions per (account, instrument), updated by the shard workers
+    PositionKeeper positions_;
+
+    // One worker and queue per shard
+    vector<unique_ptr<Shard>> shards_;
     atomic<bool> shutdown_;
-    
-    // Thread safety for orderBooks map
-    mutex orderBooksMutex_;
-    
+    atomic<size_t> interleaveWidth_{1};
+    atomic<uint64_t> rejectedCommands_{0};
+
+    // Expiry ticks are milliseconds since the engine started
+    chrono::steady_clock::time_point epoch_;
+    atomic<uint64_t> sessionCloseTick_;
+
+    // Sequenced expiry: the tick of the last expireOrders(now)
+    atomic<bool> sequencedExpiry_{false};
+    atomic<uint64_t> sequencedTick_{0};
+
+    // Thread safety for the instrument table
+    mutex instrumentsMutex_;
+
+    // Serialises processBatch and compactIdleBooks. processBatch owns the
+    // instruments' pending buffers and the per-shard scratch lists below.
+    mutex batchMutex_;
+    vector<vector<Instrument*>> batchInstruments_;
+
     // Thread pool worker function
-    void workerThread();
-    
-    // Process a single symbol's orders
-    void processSymbolOrders(const string& symbol, const vector<Order>& orders);
-    
-    // Creates a new order book if it doesn't exist
-    shared_ptr<OrderBook> getOrCreateOrderBook(const string& symbol);
-    
+    void workerThread(Shard& shard);
+
+    // Apply one instrument's pending commands, promoting it to a full book
+    // on its first order
+    void processSymbolCommands(Shard& shard, Instrument& instrument);
+
+    // Apply the pending commands of several instruments, `width` books at a
+    // time in lockstep
+    void processInterleaved(Shard& shard, const vector<Instrument*>& instruments, size_t width);
+
+    // Apply the cursor's next unit of work: a run of new orders, added and
+    // matched under one book lock, or one other command. Promotes the
+    // instrument to a full book on its first order. Returns false, with the pending buffer
+    // released, once every command was applied.
+    bool stepSymbolCommands(Shard& shard, SymbolCursor& cursor);
+
+    // Prefetch the index slots of the cursor's next step (stage one)
+    void prefetchStepIndex(const SymbolCursor& cursor) const;
+
+    // Prefetch the order nodes or level the cursor's next step will touch
+    // first, reading the slots stage one fetched (stage two)
+    void prefetchSymbolStep(const SymbolCursor& cursor) const;
+
+    // Add, match and register expiries for a run of new orders
+    void addAndMatch(Shard& shard, Instrument& instrument, OrderBook& book, const vector<Order>& orders);
+
+    // Cancel/replace a resting order, move its expiry and match the result
+    void replaceAndMatch(Shard& shard, Instrument& instrument, OrderBook& book, const ReplaceOrder& replace);
+
+    // Update both sides of an account's quote and match the result
+    void quoteAndMatch(Shard& shard, Instrument& instrument, OrderBook& book, const Quote& quote);
+
+    // The cursor's book, promoting the instrument to a full book if needed
+    OrderBook& promote(SymbolCursor& cursor);
+
+    // Cancel an account's orders in one book along with their expiry timers
+    void cancelAccountOrders(Shard& shard, OrderBook& book, const MassCancel& massCancel);
+
+    // Start the expiry timer of a resting order. An id names the newest
+    // order that used it, so a timer still held under the id is dropped.
+    void scheduleExpiry(Shard& shard, Instrument& instrument, uint64_t orderId, uint64_t tick);
+
+    // Drop the expiry timer of an order that left the book
+    void cancelExpiry(Shard& shard, uint64_t orderId);
+
+    // Drop the expiry timers of the orders the fills took out of the book
+    void cancelFilledExpiries(Shard& shard, const OrderBook& book, const vector<Fill>& fills);
+
+    // Batched removal of every order whose expiry is due at `nowTick`
+    void expireDueOrders(Shard& shard, uint64_t nowTick);
+
+    // What arriving orders are checked against: the wall clock, or the
+    // sequenced clock
+    uint64_t arrivalTick() const;
+
+    // NEVER for GTC orders and DAY orders without a session close
+    uint64_t expiryTickFor(const Order& order) const;
+
+    uint64_t toTick(chrono::steady_clock::time_point time) const;
+
+    size_t shardFor(const string& symbol) const;
+
+    // Queue a task on a shard and return its completion future
+    future<void> submit(size_t shardIndex, Task task);
+
+    // Looks up or registers an instrument; instrumentsMutex_ must be held
+    Instrument& findOrAddInstrument(const string& symbol);
+
+    // Append a command to its instrument's pending buffer for this batch.
+    // `last` caches the previous instrument. instrumentsMutex_ must be held.
+    void enqueue(const string& symbol, const Command& cmd, Instrument*& last);
+    void enqueueQuotes(const MassQuote& massQuote, Instrument*& last);
+
+    // Cancel an account's orders in every instrument this shard owns
+    void massCancelOnShard(Shard& shard, const MassCancel& massCancel);
+
+    // Submit one task per shard with work in perShard (leaving the lists
+    // empty for reuse) and wait for all of them
+    void runOnShards(vector<vector<Instrument*>>& perShard, TaskKind kind);
+
+    // Fan an account-wide mass cancel out to every shard and wait
+    void runMassCancel(const MassCancel& massCancel);
+
     // Initialize thread pool
     void initializeThreadPool(size_t numThreads);
-    
+
     // Shutdown thread pool
     void shutdownThreadPool();
 };
@@ -20,6 +20,25 @@ enum class Side {
     SELL
 };
 
+enum class TimeInForce {
+    GTC,    // Good till cancelled
+    DAY,    // Expires at the engine's session close
+    GTD     // Expires at expireTime
+};
+
+// Resting quotes use reserved order ids, one per (account, side), so a new
+// quote finds the one it replaces through the book's ordinary id index
+constexpr uint64_t QUOTE_ID_FLAG = uint64_t{1} << 63;
+
+inline uint64_t quoteOrderId(uint32_t account, Side side) {
+    return QUOTE_ID_FLAG | (static_cast<uint64_t>(account) << 1) | (side == Side::SELL ? 1 : 0);
+}
+
+// Client order ids must not use the reserved range
+inline bool isQuoteOrderId(uint64_t orderId) {
+    return (orderId & QUOTE_ID_FLAG) != 0;
+}
+
 struct Order {
     uint64_t orderId;
     string symbol;
@@ -28,6 +47,10 @@ struct Order {
     Side side;
     OrderType type;
     chrono::time_point<chrono::steady_clock> timestamp;
+    uint32_t account = 0;   // Owning account, 0 when unassigned
+    TimeInForce timeInForce = TimeInForce::GTC;
+    chrono::time_point<chrono::steady_clock> expireTime{};  // GTD only
+    uint32_t displayQuantity = 0;   // Iceberg slice size; 0 shows the whole quantity
     
     // For efficient comparison in containers
     bool operator<(const Order& other) const {
@@ -1,181 +1,114 @@
 #include "OrderBook.hpp"
-#include <algorithm>
-#include <cassert>
 
 namespace tme {
 
 using namespace std;
 
-OrderBook::OrderBook(const string& symbol) : symbol_(symbol) {}
+OrderBook::OrderBook(const string& symbol, const BookConfig& config)
+    : config_(config), impl_(makeImpl(symbol, config)) {}
 
-void OrderBook::addOrder(const Order& order) {
-    unique_lock<shared_mutex> lock(mutex_);
-    
-    if (order.side == Side::BUY) {
-        auto& priceLevel = buyOrders_[order.price];
-        priceLevel.push_back(order);
-        auto it = priceLevel.end();
-        --it;
-        orderLookup_[order.orderId] = make_pair(order.price, it);
-    } else {
-        auto& priceLevel = sellOrders_[order.price];
-        priceLevel.push_back(order);
-        auto it = priceLevel.end();
-        --it;
-        orderLookup_[order.orderId] = make_pair(order.price, it);
+namespace {
+
+template <typename Impl, typename MatchPolicy>
+Impl makeWithLocking(const string& symbol, const BookConfig& config, MatchPolicy policy) {
+    if (config.locking == LockingMode::NONE) {
+        return Impl(in_place_type<BasicOrderBook<MatchPolicy, NoLocking>>, symbol, move(policy));
     }
+    return Impl(in_place_type<BasicOrderBook<MatchPolicy, SharedMutexLocking>>, symbol, move(policy));
 }
 
-void OrderBook::addOrdersBatch(const vector<Order>& orders) {
-    unique_lock<shared_mutex> lock(mutex_);
-    
-    // Process all orders in a single lock acquisition
-    for (const Order& order : orders) {
-        if (order.side == Side::BUY) {
-            auto& priceLevel = buyOrders_[order.price];
-            priceLevel.push_back(order);
-            auto it = priceLevel.end();
-            --it;
-            orderLookup_[order.orderId] = make_pair(order.price, it);
-        } else {
-            auto& priceLevel = sellOrders_[order.price];
-            priceLevel.push_back(order);
-            auto it = priceLevel.end();
-            --it;
-            orderLookup_[order.orderId] = make_pair(order.price, it);
-        }
+} // namespace
+
+OrderBook::Impl OrderBook::makeImpl(const string& symbol, const BookConfig& config) {
+    switch (config.matching) {
+        case MatchingMode::PRO_RATA:
+            return makeWithLocking<Impl>(symbol, config, ProRataMatching());
+        case MatchingMode::FIFO_LMM:
+            return makeWithLocking<Impl>(symbol, config,
+                                         FifoLmmMatching(config.lmmAccount, config.lmmAllocationPercent));
+        case MatchingMode::FIFO:
+        default:
+            return makeWithLocking<Impl>(symbol, config, FifoMatching());
     }
 }
 
+void OrderBook::addOrder(const Order& order) {
+    visit([&](auto& book) { book.addOrder(order); }, impl_);
+}
+
+void OrderBook::addOrdersBatch(const vector<Order>& orders) {
+    visit([&](auto& book) { book.addOrdersBatch(orders); }, impl_);
+}
+
+vector<Fill> OrderBook::addAndMatchOrders(const vector<Order>& orders) {
+    return visit([&](auto& book) { return book.addAndMatchOrders(orders); }, impl_);
+}
+
 bool OrderBook::cancelOrder(uint64_t orderId) {
-    unique_lock<shared_mutex> lock(mutex_);
-    
-    auto lookup = orderLookup_.find(orderId);
-    if (lookup == orderLookup_.end()) {
-        return false;  // Order not found
-    }
-    
-    const auto& price = lookup->second.first;
-    const auto& orderIt = lookup->second.second;
-    const auto& order = *orderIt;
-    
-    if (order.side == Side::BUY) {
-        auto priceIt = buyOrders_.find(price);
-        if (priceIt != buyOrders_.end()) {
-            auto& priceLevel = priceIt->second;
-            priceLevel.erase(orderIt);
-            
-            // Clean up empty price levels
-            if (priceLevel.empty()) {
-                buyOrders_.erase(priceIt);
-            }
-        }
-    } else {
-        auto priceIt = sellOrders_.find(price);
-        if (priceIt != sellOrders_.end()) {
-            auto& priceLevel = priceIt->second;
-            priceLevel.erase(orderIt);
-            
-            // Clean up empty price levels
-            if (priceLevel.empty()) {
-                sellOrders_.erase(priceIt);
-            }
-        }
-    }
-    
-    orderLookup_.erase(lookup);
-    return true;
-}
-
-vector<pair<Order, Order>> OrderBook::matchOrders() {
-    unique_lock<shared_mutex> lock(mutex_);
-    vector<pair<Order, Order>> matches;
-    
-    // Keep matching as long as there are overlapping buy and sell orders
-    while (!buyOrders_.empty() && !sellOrders_.empty()) {
-        auto buyIt = buyOrders_.begin();
-        auto sellIt = sellOrders_.begin();
-        
-        auto& bestBidLevel = buyIt->second;
-        auto& bestAskLevel = sellIt->second;
-        
-        uint32_t bestBidPrice = buyIt->first;
-        uint32_t bestAskPrice = sellIt->first;
-        
-        // No overlap, can't match more orders
-        if (bestBidPrice < bestAskPrice) {
-            break;
-        }
-        
-        // Get the oldest orders at the best prices
-        Order& buyOrder = bestBidLevel.front();
-        Order& sellOrder = bestAskLevel.front();
-        
-        // Determine the matched quantity
-        uint32_t matchedQuantity = min(buyOrder.quantity, sellOrder.quantity);
-        
-        // Create matched pair
-        matches.emplace_back(buyOrder, sellOrder);
-        
-        // Update order quantities
-        buyOrder.quantity -= matchedQuantity;
-        sellOrder.quantity -= matchedQuantity;
-        
-        // Handle fully executed orders
-        if (buyOrder.quantity == 0) {
-            orderLookup_.erase(buyOrder.orderId);
-            bestBidLevel.pop_front();
-            
-            if (bestBidLevel.empty()) {
-                buyOrders_.erase(buyIt);
-            }
-        }
-        
-        if (sellOrder.quantity == 0) {
-            orderLookup_.erase(sellOrder.orderId);
-            bestAskLevel.pop_front();
-            
-            if (bestAskLevel.empty()) {
-                sellOrders_.erase(sellIt);
-            }
-        }
-    }
-    
-    return matches;
+    return visit([&](auto& book) { return book.cancelOrder(orderId); }, impl_);
+}
+
+size_t OrderBook::cancelOrdersBatch(const vector<uint64_t>& orderIds) {
+    return visit([&](auto& book) { return book.cancelOrdersBatch(orderIds); }, impl_);
+}
+
+size_t OrderBook::cancelAccountOrders(uint32_t account, optional<Side> side, vector<uint64_t>* cancelledIds) {
+    return visit([&](auto& book) { return book.cancelAccountOrders(account, side, cancelledIds); }, impl_);
+}
+
+bool OrderBook::reduceOrder(uint64_t orderId, uint32_t quantity) {
+    return visit([&](auto& book) { return book.reduceOrder(orderId, quantity); }, impl_);
+}
+
+optional<Order> OrderBook::replaceOrder(uint64_t orderId, uint64_t newOrderId, uint32_t price, uint32_t quantity,
+                                        chrono::steady_clock::time_point timestamp) {
+    return visit([&](auto& book) { return book.replaceOrder(orderId, newOrderId, price, quantity, timestamp); },
+                 impl_);
+}
+
+QuoteUpdate OrderBook::updateQuote(uint32_t account, Side side, uint32_t price, uint32_t quantity,
+                                   chrono::steady_clock::time_point timestamp) {
+    return visit([&](auto& book) { return book.updateQuote(account, side, price, quantity, timestamp); }, impl_);
+}
+
+void OrderBook::prefetchIndex(uint64_t orderId) const {
+    visit([&](const auto& book) { book.prefetchIndex(orderId); }, impl_);
+}
+
+void OrderBook::prefetchOrder(uint64_t orderId) const {
+    visit([&](const auto& book) { book.prefetchOrder(orderId); }, impl_);
+}
+
+void OrderBook::prefetchInsert(const Order& order) const {
+    visit([&](const auto& book) { book.prefetchInsert(order); }, impl_);
+}
+
+vector<Fill> OrderBook::matchOrders() {
+    return visit([](auto& book) { return book.matchOrders(); }, impl_);
 }
 
 uint32_t OrderBook::getBestBid() const {
-    shared_lock<shared_mutex> lock(mutex_);
-    return buyOrders_.empty() ? 0 : buyOrders_.begin()->first;
+    return visit([](const auto& book) { return book.getBestBid(); }, impl_);
 }
 
 uint32_t OrderBook::getBestAsk() const {
-    shared_lock<shared_mutex> lock(mutex_);
-    return sellOrders_.empty() ? 0 : sellOrders_.begin()->first;
-}
-
-uint32_t OrderBook::getVolumeAtPrice(Side side, uint32_t price) const {
-    shared_lock<shared_mutex> lock(mutex_);
-    
-    uint32_t volume = 0;
-    
-    if (side == Side::BUY) {
-        auto it = buyOrders_.find(price);
-        if (it != buyOrders_.end()) {
-            for (const auto& order : it->second) {
-                volume += order.quantity;
-            }
-        }
-    } else {
-        auto it = sellOrders_.find(price);
-        if (it != sellOrders_.end()) {
-            for (const auto& order : it->second) {
-                volume += order.quantity;
-            }
-        }
-    }
-    
-    return volume;
+    return visit([](const auto& book) { return book.getBestAsk(); }, impl_);
+}
+
+uint64_t OrderBook::getVolumeAtPrice(Side side, uint32_t price) const {
+    return visit([&](const auto& book) { return book.getVolumeAtPrice(side, price); }, impl_);
+}
+
+const string& OrderBook::symbol() const {
+    return visit([](const auto& book) -> const string& { return book.symbol(); }, impl_);
+}
+
+bool OrderBook::isResting(uint64_t orderId) const {
+    return visit([&](const auto& book) { return book.isResting(orderId); }, impl_);
+}
+
+size_t OrderBook::orderCount() const {
+    return visit([](const auto& book) { return book.orderCount(); }, impl_);
 }
 
 } // namespace tme
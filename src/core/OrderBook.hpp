@@ -1,25 +1,49 @@
 #pragma once
 
 #include "Order.hpp"
-#include <unordered_map>
-#include <map>
-#include <list>
+#include "BasicOrderBook.hpp"
+#include <string>
+#include <variant>
 #include <vector>
-#include <memory>
-#include <mutex>
-#include <shared_mutex>
 
 namespace tme {
 
 using namespace std;
 
+enum class MatchingMode {
+    FIFO,       // Strict price-time priority
+    PRO_RATA,   // Split across the level in proportion to size
+    FIFO_LMM    // Lead market maker allocation first, then FIFO
+};
+
+enum class LockingMode {
+    SHARED_MUTEX,   // Safe for concurrent readers and writers
+    NONE            // Single-writer books, e.g. pinned to one worker
+};
+
+// Per-instrument book configuration chosen when the book is created.
+struct BookConfig {
+    MatchingMode matching = MatchingMode::FIFO;
+    LockingMode locking = LockingMode::SHARED_MUTEX;
+    
+    // FIFO_LMM only: the lead market maker and its share of each crossing.
+    // A non-zero share needs a non-zero account; the book throws
+    // invalid_argument otherwise.
+    uint32_t lmmAccount = 0;
+    uint32_t lmmAllocationPercent = 0;
+};
+
 /**
  * OrderBook maintains a list of buy and sell orders for a specific instrument.
  * It's optimized for fast insertion, deletion, and matching of orders.
+ *
+ * The policies are fixed when the book is created: each call is dispatched
+ * once to a BasicOrderBook specialisation whose hot path carries no policy
+ * branches.
  */
 class OrderBook {
 public:
-    explicit OrderBook(const string& symbol);
+    explicit OrderBook(const string& symbol, const BookConfig& config = BookConfig());
     
     // Add a new order to the book
     void addOrder(const Order& order);
@@ -27,32 +51,70 @@ public:
     // Add multiple orders efficiently in bulk
     void addOrdersBatch(const vector<Order>& orders);
     
+    // Add and match each order in turn under one lock; the fills don't
+    // depend on how many orders are passed at once
+    vector<Fill> addAndMatchOrders(const vector<Order>& orders);
+    
     // Cancel an existing order
     bool cancelOrder(uint64_t orderId);
     
+    // Cancel several orders under one lock; returns how many were resting
+    size_t cancelOrdersBatch(const vector<uint64_t>& orderIds);
+    
+    // Cancel all resting orders of an account, optionally on one side only,
+    // collecting their ids when asked to
+    size_t cancelAccountOrders(uint32_t account, optional<Side> side = nullopt,
+                               vector<uint64_t>* cancelledIds = nullptr);
+    
+    // Take quantity off a resting order, keeping its priority
+    bool reduceOrder(uint64_t orderId, uint32_t quantity);
+    
+    // Cancel/replace on the same side; the new order loses priority
+    optional<Order> replaceOrder(uint64_t orderId, uint64_t newOrderId, uint32_t price, uint32_t quantity,
+                                 chrono::steady_clock::time_point timestamp);
+    
+    // Replace an account's quote on one side; see QuoteUpdate
+    QuoteUpdate updateQuote(uint32_t account, Side side, uint32_t price, uint32_t quantity,
+                            chrono::steady_clock::time_point timestamp);
+    
     // Match orders and execute trades
-    vector<pair<Order, Order>> matchOrders();
+    vector<Fill> matchOrders();
     
     // Get best bid/ask prices
     uint32_t getBestBid() const;
     uint32_t getBestAsk() const;
     
     // Get total volume at a price level
-    uint32_t getVolumeAtPrice(Side side, uint32_t price) const;
+    uint64_t getVolumeAtPrice(Side side, uint32_t price) const;
     
-private:
-    string symbol_;
+    // Two-stage cache hints for the thread that modifies the book: first
+    // prefetchIndex, then a round later prefetchOrder or prefetchInsert
+    void prefetchIndex(uint64_t orderId) const;
+    void prefetchOrder(uint64_t orderId) const;
+    void prefetchInsert(const Order& order) const;
     
-    // Price-time priority queues for buy and sell orders
-    // Using map for price levels and list for time priority
-    map<uint32_t, list<Order>, greater<>> buyOrders_;  // Higher prices first
-    map<uint32_t, list<Order>> sellOrders_;            // Lower prices first
+    // Whether orderId is resting in the book
+    bool isResting(uint64_t orderId) const;
+
+    // Number of resting orders
+    size_t orderCount() const;
+    
+    const string& symbol() const;
+    const BookConfig& config() const { return config_; }
+    
+private:
+    using Impl = variant<
+        BasicOrderBook<FifoMatching, SharedMutexLocking>,
+        BasicOrderBook<FifoMatching, NoLocking>,
+        BasicOrderBook<ProRataMatching, SharedMutexLocking>,
+        BasicOrderBook<ProRataMatching, NoLocking>,
+        BasicOrderBook<FifoLmmMatching, SharedMutexLocking>,
+        BasicOrderBook<FifoLmmMatching, NoLocking>>;
     
-    // Fast lookup by order ID
-    unordered_map<uint64_t, pair<uint32_t, list<Order>::iterator>> orderLookup_;
+    static Impl makeImpl(const string& symbol, const BookConfig& config);
     
-    // Thread safety
-    mutable shared_mutex mutex_;
+    BookConfig config_;
+    Impl impl_;
 };
 
 } // namespace tme
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace tme {
+
+using namespace std;
+
+/**
+ * Order id -> Value hash index with open addressing and linear probing.
+ * Unlike unordered_map the slot an id hashes to is plain address
+ * arithmetic (slotFor), so a caller can prefetch it one step and read it
+ * the next without walking a bucket chain first. At most half the slots
+ * are used; erase shifts the rest of a probe run back instead of leaving
+ * tombstones.
+ *
+ * Not thread-safe; the owning book guards it.
+ */
+template <typename Value>
+class OrderIndex {
+public:
+    OrderIndex() { rehash(INITIAL_CAPACITY); }
+
+    Value* find(uint64_t orderId) {
+        for (size_t i = home(orderId);; i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (!slot.used) {
+                return nullptr;
+            }
+            if (slot.orderId == orderId) {
+                return &slot.value;
+            }
+        }
+    }
+
+    const Value* find(uint64_t orderId) const {
+        return const_cast<OrderIndex*>(this)->find(orderId);
+    }
+
+    // Inserts or overwrites
+    void set(uint64_t orderId, const Value& value) {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            rehash(slots_.size() * 2);
+        }
+        place(orderId, value);
+    }
+
+    bool erase(uint64_t orderId) {
+        size_t hole = home(orderId);
+        for (;; hole = (hole + 1) & mask_) {
+            if (!slots_[hole].used) {
+                return false;
+            }
+            if (slots_[hole].orderId == orderId) {
+                break;
+            }
+        }
+
+        // Move back every later entry of the run that may not sit past the hole
+        for (size_t i = (hole + 1) & mask_; slots_[i].used; i = (i + 1) & mask_) {
+            size_t wanted = home(slots_[i].orderId);
+            bool reachable = hole <= i ? (wanted <= hole || wanted > i) : (wanted <= hole && wanted > i);
+            if (reachable) {
+                slots_[hole] = slots_[i];
+                hole = i;
+            }
+        }
+        slots_[hole].used = false;
+        --size_;
+        return true;
+    }
+
+    // First slot probed for orderId; its address is all a prefetch needs
+    const void* slotFor(uint64_t orderId) const { return &slots_[home(orderId)]; }
+
+    size_t size() const { return size_; }
+
+private:
+    static constexpr size_t INITIAL_CAPACITY = 16;
+
+    struct Slot {
+        uint64_t orderId = 0;
+        Value value{};
+        bool used = false;
+    };
+
+    // Fibonacci hashing: sequential ids spread over the whole table
+    size_t home(uint64_t orderId) const {
+        return static_cast<size_t>((orderId * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+
+    void place(uint64_t orderId, const Value& value) {
+        size_t i = home(orderId);
+        while (slots_[i].used && slots_[i].orderId != orderId) {
+            i = (i + 1) & mask_;
+        }
+        if (!slots_[i].used) {
+            slots_[i].used = true;
+            slots_[i].orderId = orderId;
+            ++size_;
+        }
+        slots_[i].value = value;
+    }
+
+    void rehash(size_t capacity) {
+        vector<Slot> old(capacity);
+        old.swap(slots_);
+        mask_ = capacity - 1;
+        shift_ = 64;
+        for (size_t c = capacity; c > 1; c >>= 1) {
+            --shift_;
+        }
+        size_ = 0;
+        for (const Slot& slot : old) {
+            if (slot.used) {
+                place(slot.orderId, slot.value);
+            }
+        }
+    }
+
+    vector<Slot> slots_;
+    size_t mask_ = 0;
+    unsigned shift_ = 64;
+    size_t size_ = 0;
+};
+
+} // namespace tme
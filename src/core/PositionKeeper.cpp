@@ -0,0 +1,214 @@
+#include "PositionKeeper.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace tme {
+
+using namespace std;
+
+namespace {
+
+constexpr size_t DIRECTORY_SIZE = size_t{1} << 16;
+
+uint64_t positionKey(uint32_t account, uint32_t instrumentId) {
+    return (static_cast<uint64_t>(account) << 32) | instrumentId;
+}
+
+} // namespace
+
+PositionKeeper::PositionKeeper(size_t shards)
+    : shardCount_(max<size_t>(shards, 1)), directory_(new atomic<Leaf*>[DIRECTORY_SIZE]) {
+    for (size_t i = 0; i < shardCount_; ++i) {
+        shards_.push_back(make_unique<ShardState>());
+    }
+    for (size_t i = 0; i < DIRECTORY_SIZE; ++i) {
+        directory_[i].store(nullptr, memory_order_relaxed);
+    }
+}
+
+PositionKeeper::ShardSlot::~ShardSlot() {
+    PositionSlot* slot = positions.load(memory_order_relaxed);
+    while (slot) {
+        delete exchange(slot, slot->next);
+    }
+}
+
+PositionKeeper::~PositionKeeper() {
+    for (size_t i = 0; i < DIRECTORY_SIZE; ++i) {
+        Leaf* leaf = directory_[i].load(memory_order_relaxed);
+        if (!leaf) {
+            continue;
+        }
+        for (auto& slot : *leaf) {
+            delete slot.load(memory_order_relaxed);
+        }
+        delete leaf;
+    }
+}
+
+void PositionKeeper::onFills(size_t shard, uint32_t instrumentId, const vector<Fill>& fills) {
+    ShardState& state = *shards_[shard];
+    for (const Fill& fill : fills) {
+        if (fill.buy.account != 0) {
+            apply(state, fill.buy.account, instrumentId, fill.quantity, fill.price);
+        }
+        if (fill.sell.account != 0) {
+            apply(state, fill.sell.account, instrumentId, -static_cast<int64_t>(fill.quantity), fill.price);
+        }
+    }
+
+    // Publish each account and position that traded once per call
+    for (AccountTotals* totals : state.dirty) {
+        findOrCreate(totals->account).shards[shard].exposure.store(totals->exposure);
+        totals->dirty = false;
+    }
+    state.dirty.clear();
+
+    for (TrackedPosition* tracked : state.dirtyPositions) {
+        if (tracked->published) {
+            tracked->published->position.store(tracked->position);
+        } else {
+            // Filled in before it is linked, so readers never see it empty
+            atomic<PositionSlot*>& head = findOrCreate(tracked->account).shards[shard].positions;
+            auto* slot = new PositionSlot{tracked->instrumentId, {}, head.load(memory_order_relaxed)};
+            slot->position.store(tracked->position);
+            head.store(slot, memory_order_release);
+            tracked->published = slot;
+        }
+        tracked->dirty = false;
+    }
+    state.dirtyPositions.clear();
+}
+
+void PositionKeeper::apply(ShardState& state, uint32_t account, uint32_t instrumentId, int64_t quantity,
+                           uint32_t price) {
+    TrackedPosition& tracked = state.positions[positionKey(account, instrumentId)];
+    if (!tracked.dirty) {
+        tracked.account = account;
+        tracked.instrumentId = instrumentId;
+        tracked.dirty = true;
+        state.dirtyPositions.push_back(&tracked);
+    }
+    Position& position = tracked.position;
+    AccountTotals& accountTotals = state.totals[account];
+    if (!accountTotals.dirty) {
+        accountTotals.account = account;
+        accountTotals.dirty = true;
+        state.dirty.push_back(&accountTotals);
+    }
+    AccountExposure& totals = accountTotals.exposure;
+
+    double oldCost = position.openCost;
+    bool wasOpen = position.netQuantity != 0;
+
+    if (position.netQuantity == 0 || (position.netQuantity > 0) == (quantity > 0)) {
+        // Opening or adding to the position
+        position.netQuantity += quantity;
+        position.openCost += static_cast<double>(quantity) * price;
+    } else {
+        // Closing, possibly flipping to the other side
+        int64_t direction = position.netQuantity > 0 ? 1 : -1;
+        int64_t closing = min(llabs(quantity), llabs(position.netQuantity));
+        double average = position.averagePrice();
+        double realized = static_cast<double>(closing) * (price - average) * direction;
+        position.realizedPnl += realized;
+        totals.realizedPnl += realized;
+        position.netQuantity -= direction * closing;
+        position.openCost = position.netQuantity == 0 ? 0 : average * position.netQuantity;
+
+        int64_t opening = llabs(quantity) - closing;
+        if (opening > 0) {
+            position.netQuantity = -direction * opening;
+            position.openCost = static_cast<double>(position.netQuantity) * price;
+        }
+    }
+
+    if (quantity > 0) {
+        position.boughtQuantity += static_cast<uint64_t>(quantity);
+        totals.boughtQuantity += static_cast<uint64_t>(quantity);
+    } else {
+        position.soldQuantity += static_cast<uint64_t>(-quantity);
+        totals.soldQuantity += static_cast<uint64_t>(-quantity);
+    }
+    totals.netNotional += position.openCost - oldCost;
+    totals.grossNotional += fabs(position.openCost) - fabs(oldCost);
+    if (wasOpen && position.netQuantity == 0) {
+        --totals.openPositions;
+    } else if (!wasOpen && position.netQuantity != 0) {
+        ++totals.openPositions;
+    }
+    ++totals.fills;
+}
+
+Position PositionKeeper::position(uint32_t account, uint32_t instrumentId) const {
+    AccountSlots* slots = find(account);
+    if (!slots) {
+        return Position();
+    }
+    // An instrument trades on one shard only, so the first match is it
+    for (size_t i = 0; i < shardCount_; ++i) {
+        for (PositionSlot* slot = slots->shards[i].positions.load(memory_order_acquire); slot; slot = slot->next) {
+            if (slot->instrumentId == instrumentId) {
+                return slot->position.load();
+            }
+        }
+    }
+    return Position();
+}
+
+AccountExposure PositionKeeper::exposure(uint32_t account) const {
+    AccountExposure sum;
+    AccountSlots* slots = find(account);
+    if (!slots) {
+        return sum;
+    }
+    for (size_t i = 0; i < shardCount_; ++i) {
+        AccountExposure part = slots->shards[i].exposure.load();
+        sum.netNotional += part.netNotional;
+        sum.grossNotional += part.grossNotional;
+        sum.realizedPnl += part.realizedPnl;
+        sum.boughtQuantity += part.boughtQuantity;
+        sum.soldQuantity += part.soldQuantity;
+        sum.fills += part.fills;
+        sum.openPositions += part.openPositions;
+    }
+    return sum;
+}
+
+PositionKeeper::AccountSlots* PositionKeeper::find(uint32_t account) const {
+    Leaf* leaf = directory_[account >> LEAF_BITS].load(memory_order_acquire);
+    return leaf ? (*leaf)[account & (LEAF_SIZE - 1)].load(memory_order_acquire) : nullptr;
+}
+
+PositionKeeper::AccountSlots& PositionKeeper::findOrCreate(uint32_t account) {
+    if (AccountSlots* slots = find(account)) {
+        return *slots;
+    }
+
+    // Shards can race to create the same entry; the loser frees its copy
+    atomic<Leaf*>& leafRef = directory_[account >> LEAF_BITS];
+    Leaf* leaf = leafRef.load(memory_order_acquire);
+    if (!leaf) {
+        Leaf* created = new Leaf();
+        if (leafRef.compare_exchange_strong(leaf, created, memory_order_acq_rel)) {
+            leaf = created;
+        } else {
+            delete created;
+        }
+    }
+
+    atomic<AccountSlots*>& slotRef = (*leaf)[account & (LEAF_SIZE - 1)];
+    AccountSlots* slots = slotRef.load(memory_order_acquire);
+    if (!slots) {
+        AccountSlots* created = new AccountSlots(shardCount_);
+        if (slotRef.compare_exchange_strong(slots, created, memory_order_acq_rel)) {
+            slots = created;
+        } else {
+            delete created;
+        }
+    }
+    return *slots;
+}
+
+} // namespace tme
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "BookPolicies.hpp"
+#include "SeqLock.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace tme {
+
+using namespace std;
+
+// One account's holding in one instrument. Costs are in price units times
+// quantity; openCost carries the sign of the position.
+struct Position {
+    int64_t netQuantity = 0;        // Long > 0, short < 0
+    double openCost = 0;            // Notional of the open position at cost
+    double realizedPnl = 0;
+    uint64_t boughtQuantity = 0;
+    uint64_t soldQuantity = 0;
+
+    double averagePrice() const { return netQuantity == 0 ? 0 : openCost / netQuantity; }
+};
+
+// An account's positions summed over every instrument
+struct AccountExposure {
+    double netNotional = 0;         // Sum of signed open cost
+    double grossNotional = 0;       // Sum of absolute open cost
+    double realizedPnl = 0;
+    uint64_t boughtQuantity = 0;
+    uint64_t soldQuantity = 0;
+    uint64_t fills = 0;
+    uint64_t openPositions = 0;     // Instruments with a non-zero position
+};
+
+/**
+ * Positions built from the engine's own fills, sharded like the books.
+ *
+ * Each shard worker owns the positions of the instruments on its shard and
+ * keeps a private running total per account. After each matchOrders call
+ * it publishes the totals of the accounts that traded into that account's
+ * per-shard SeqLock slot, and each position that changed into its own
+ * SeqLock, linked from the account's shard slot the first time it trades.
+ * Readers on any thread find the account through an insert-only radix
+ * directory and add the shard slots up, or walk them for one position,
+ * without taking a lock. Each shard's part is internally consistent; parts
+ * from different shards may be a batch apart.
+ *
+ * Account 0 (orders without an account) is not tracked.
+ */
+class PositionKeeper {
+public:
+    explicit PositionKeeper(size_t shards);
+    ~PositionKeeper();
+
+    PositionKeeper(const PositionKeeper&) = delete;
+    PositionKeeper& operator=(const PositionKeeper&) = delete;
+
+    // Shard worker only: applies the fills of one matchOrders call
+    void onFills(size_t shard, uint32_t instrumentId, const vector<Fill>& fills);
+
+    // Any thread, lock-free. Walks the instruments the account traded.
+    Position position(uint32_t account, uint32_t instrumentId) const;
+
+    // Any thread, lock-free
+    AccountExposure exposure(uint32_t account) const;
+
+private:
+    static constexpr size_t LEAF_BITS = 16;
+    static constexpr size_t LEAF_SIZE = size_t{1} << LEAF_BITS;
+
+    // Published position of one account in one instrument. Only the owning
+    // shard links slots, at the head of its list, and never unlinks them.
+    struct PositionSlot {
+        uint32_t instrumentId;
+        SeqLock<Position> position;
+        PositionSlot* next;
+    };
+
+    struct alignas(64) ShardSlot {
+        ~ShardSlot();
+
+        SeqLock<AccountExposure> exposure;
+        atomic<PositionSlot*> positions{nullptr};
+    };
+
+    // Published per-shard totals of one account
+    struct AccountSlots {
+        explicit AccountSlots(size_t shards) : shards(new ShardSlot[shards]) {}
+        unique_ptr<ShardSlot[]> shards;
+    };
+
+    using Leaf = array<atomic<AccountSlots*>, LEAF_SIZE>;
+
+    // Worker-private running total of an account on one shard
+    struct AccountTotals {
+        uint32_t account = 0;
+        bool dirty = false;     // Traded since the last publish
+        AccountExposure exposure;
+    };
+
+    // Worker-private position and where it is published
+    struct TrackedPosition {
+        uint32_t account = 0;
+        uint32_t instrumentId = 0;
+        bool dirty = false;     // Traded since the last publish
+        Position position;
+        PositionSlot* published = nullptr;
+    };
+
+    struct ShardState {
+        unordered_map<uint64_t, TrackedPosition> positions;     // (account << 32) | instrument
+        unordered_map<uint32_t, AccountTotals> totals;
+        vector<AccountTotals*> dirty;
+        vector<TrackedPosition*> dirtyPositions;
+    };
+
+    void apply(ShardState& state, uint32_t account, uint32_t instrumentId, int64_t quantity, uint32_t price);
+    AccountSlots* find(uint32_t account) const;
+    AccountSlots& findOrCreate(uint32_t account);
+
+    size_t shardCount_;
+    vector<unique_ptr<ShardState>> shards_;
+    unique_ptr<atomic<Leaf*>[]> directory_;
+};
+
+} // namespace tme
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace tme {
+
+using namespace std;
+
+/**
+ * Single-writer sequence lock around a small trivially copyable value.
+ * The writer never blocks and readers never write shared memory: a reader
+ * copies the value and retries if the sequence moved (or was odd, i.e. a
+ * store was in progress) while it copied. The payload is kept as relaxed
+ * atomic words so the racing copy is well defined.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(is_trivially_copyable_v<T>, "SeqLock payload must be trivially copyable");
+
+public:
+    SeqLock() { store(T{}); }
+
+    // Only one thread may store to a given SeqLock
+    void store(const T& value) {
+        array<uint64_t, WORDS> words{};
+        memcpy(words.data(), &value, sizeof(T));
+
+        uint64_t sequence = sequence_.load(memory_order_relaxed);
+        sequence_.store(sequence + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            words_[i].store(words[i], memory_order_relaxed);
+        }
+        sequence_.store(sequence + 2, memory_order_release);
+    }
+
+    T load() const {
+        array<uint64_t, WORDS> words;
+        uint64_t before;
+        uint64_t after;
+        do {
+            before = sequence_.load(memory_order_acquire);
+            for (size_t i = 0; i < WORDS; ++i) {
+                words[i] = words_[i].load(memory_order_relaxed);
+            }
+            atomic_thread_fence(memory_order_acquire);
+            after = sequence_.load(memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        T value;
+        memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    atomic<uint64_t> sequence_{0};
+    array<atomic<uint64_t>, WORDS> words_{};
+};
+
+} // namespace tme
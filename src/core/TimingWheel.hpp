@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace tme {
+
+using namespace std;
+
+/**
+ * Hierarchical timing wheel (LEVELS x 64 slots, 6 bits of the tick per
+ * level). Timers live in a node pool and are linked into their slot with
+ * intrusive prev/next indices, so schedule and cancel are O(1). advance()
+ * walks the ticks that elapsed, cascading coarser levels into finer ones as
+ * their slot comes up, and hands back every payload that became due.
+ *
+ * Not thread-safe: each wheel is owned by one worker.
+ */
+template <typename Payload>
+class TimingWheel {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+    explicit TimingWheel(uint64_t startTick = 0) : now_(startTick) {
+        slots_.fill(INVALID_HANDLE);
+    }
+
+    // Registers payload to fire once the wheel reaches expiryTick. Ticks at
+    // or before the current tick fire on the next advance().
+    Handle schedule(uint64_t expiryTick, const Payload& payload) {
+        Handle handle = allocate();
+        Node& node = nodes_[handle];
+        node.payload = payload;
+        node.expiry = expiryTick;
+        link(handle);
+        ++size_;
+        return handle;
+    }
+
+    // Removes a pending timer. Handles that already fired must not be reused.
+    void cancel(Handle handle) {
+        unlink(handle);
+        release(handle);
+        --size_;
+    }
+
+    // Moves the wheel forward to tick and appends every due payload to expired.
+    void advance(uint64_t tick, vector<Payload>& expired) {
+        if (size_ == 0) {
+            now_ = tick > now_ ? tick : now_;
+            return;
+        }
+
+        while (now_ < tick) {
+            ++now_;
+
+            // Pull the next span of every coarser level whose slot just came up
+            for (size_t level = 1; level < LEVELS; ++level) {
+                if ((now_ & mask(level)) != 0) {
+                    break;
+                }
+                cascade(slotIndex(level, now_), expired);
+            }
+
+            Handle handle = slots_[slotIndex(0, now_)];
+            slots_[slotIndex(0, now_)] = INVALID_HANDLE;
+            while (handle != INVALID_HANDLE) {
+                Handle next = nodes_[handle].next;
+                expired.push_back(nodes_[handle].payload);
+                release(handle);
+                --size_;
+                handle = next;
+            }
+
+            if (size_ == 0) {
+                now_ = tick;
+            }
+        }
+    }
+
+    uint64_t now() const { return now_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    static constexpr size_t LEVELS = 4;
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+    static constexpr uint64_t RANGE = uint64_t{1} << (LEVELS * SLOT_BITS);
+
+    struct Node {
+        Payload payload;
+        uint64_t expiry;
+        Handle prev;
+        Handle next;
+        uint32_t slot;
+    };
+
+    // Low bits of the tick that must be zero for `level` to cascade
+    static constexpr uint64_t mask(size_t level) {
+        return (uint64_t{1} << (level * SLOT_BITS)) - 1;
+    }
+
+    static size_t slotIndex(size_t level, uint64_t tick) {
+        return level * SLOTS + ((tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+    }
+
+    void link(Handle handle) {
+        Node& node = nodes_[handle];
+
+        uint64_t expiry = node.expiry > now_ ? node.expiry : now_ + 1;
+        uint64_t delta = expiry - now_;
+        if (delta >= RANGE) {
+            // Beyond the wheel's horizon: park in the last top-level slot and
+            // re-place it when that slot cascades
+            expiry = now_ + RANGE - 1;
+            delta = RANGE - 1;
+        }
+
+        size_t level = 0;
+        while (level + 1 < LEVELS && delta >= (uint64_t{1} << ((level + 1) * SLOT_BITS))) {
+            ++level;
+        }
+
+        uint32_t slot = static_cast<uint32_t>(slotIndex(level, expiry));
+        node.slot = slot;
+        node.prev = INVALID_HANDLE;
+        node.next = slots_[slot];
+        if (node.next != INVALID_HANDLE) {
+            nodes_[node.next].prev = handle;
+        }
+        slots_[slot] = handle;
+    }
+
+    void unlink(Handle handle) {
+        Node& node = nodes_[handle];
+        if (node.prev != INVALID_HANDLE) {
+            nodes_[node.prev].next = node.next;
+        } else {
+            slots_[node.slot] = node.next;
+        }
+        if (node.next != INVALID_HANDLE) {
+            nodes_[node.next].prev = node.prev;
+        }
+    }
+
+    void cascade(size_t slot, vector<Payload>& expired) {
+        Handle handle = slots_[slot];
+        slots_[slot] = INVALID_HANDLE;
+        while (handle != INVALID_HANDLE) {
+            Handle next = nodes_[handle].next;
+            if (nodes_[handle].expiry <= now_) {
+                expired.push_back(nodes_[handle].payload);
+                release(handle);
+                --size_;
+            } else {
+                link(handle);
+            }
+            handle = next;
+        }
+    }
+
+    Handle allocate() {
+        if (freeList_ != INVALID_HANDLE) {
+            Handle handle = freeList_;
+            freeList_ = nodes_[handle].next;
+            return handle;
+        }
+        nodes_.emplace_back();
+        return static_cast<Handle>(nodes_.size() - 1);
+    }
+
+    void release(Handle handle) {
+        nodes_[handle].next = freeList_;
+        freeList_ = handle;
+    }
+
+    uint64_t now_;
+    size_t size_ = 0;
+    array<Handle, LEVELS * SLOTS> slots_;
+    vector<Node> nodes_;
+    Handle freeList_ = INVALID_HANDLE;
+};
+
+} // namespace tme
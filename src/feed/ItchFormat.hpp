@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tme {
+namespace feed {
+
+using namespace std;
+
+// Subset of the NASDAQ TotalView-ITCH 5.0 layout the reader understands.
+// Files are a sequence of messages, each prefixed with its length as a
+// big-endian uint16 (the "BinaryFILE" framing). All fields are big-endian;
+// prices carry four implied decimals.
+namespace itch {
+
+constexpr char STOCK_DIRECTORY = 'R';
+constexpr char ADD_ORDER = 'A';
+constexpr char ADD_ORDER_MPID = 'F';
+constexpr char ORDER_EXECUTED = 'E';
+constexpr char ORDER_EXECUTED_WITH_PRICE = 'C';
+constexpr char ORDER_CANCEL = 'X';
+constexpr char ORDER_DELETE = 'D';
+constexpr char ORDER_REPLACE = 'U';
+
+// Message sizes, type byte included
+constexpr size_t STOCK_DIRECTORY_SIZE = 39;
+constexpr size_t ADD_ORDER_SIZE = 36;
+constexpr size_t ADD_ORDER_MPID_SIZE = 40;
+constexpr size_t ORDER_EXECUTED_SIZE = 31;
+constexpr size_t ORDER_EXECUTED_WITH_PRICE_SIZE = 36;
+constexpr size_t ORDER_CANCEL_SIZE = 23;
+constexpr size_t ORDER_DELETE_SIZE = 19;
+constexpr size_t ORDER_REPLACE_SIZE = 35;
+
+// Every message starts with type, stock locate, tracking number and a
+// 6-byte timestamp in nanoseconds since midnight
+constexpr size_t LOCATE_OFFSET = 1;
+constexpr size_t TIMESTAMP_OFFSET = 5;
+constexpr size_t BODY_OFFSET = 11;
+constexpr size_t STOCK_SIZE = 8;
+
+inline uint64_t loadBigEndian(const uint8_t* p, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+inline void storeBigEndian(uint8_t* p, uint64_t value, size_t bytes) {
+    for (size_t i = bytes; i-- > 0;) {
+        p[i] = static_cast<uint8_t>(value);
+        value >>= 8;
+    }
+}
+
+} // namespace itch
+
+} // namespace feed
+} // namespace tme
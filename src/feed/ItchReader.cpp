@@ -0,0 +1,214 @@
+#include "ItchReader.hpp"
+#include "ItchFormat.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tme {
+namespace feed {
+
+using namespace std;
+using namespace std::chrono;
+using namespace itch;
+
+namespace {
+
+constexpr size_t LOCATE_COUNT = 1 << 16;
+
+runtime_error systemError(const string& what, const string& path) {
+    return runtime_error(what + " " + path + ": " + strerror(errno));
+}
+
+string trimStock(const uint8_t* stock) {
+    size_t length = STOCK_SIZE;
+    while (length > 0 && stock[length - 1] == ' ') {
+        --length;
+    }
+    return string(reinterpret_cast<const char*>(stock), length);
+}
+
+} // namespace
+
+ItchReader::ItchReader(const string& path) : base_(steady_clock::now()), symbols_(LOCATE_COUNT) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw systemError("open", path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw systemError("fstat", path);
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ > 0) {
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw systemError("mmap", path);
+        }
+        madvise(mapping, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const uint8_t*>(mapping);
+    }
+    close(fd);
+}
+
+ItchReader::~ItchReader() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+size_t ItchReader::frameLength() const {
+    if (size_ - offset_ < 2) {
+        return 0;
+    }
+    size_t length = loadBigEndian(data_ + offset_, 2);
+    return length <= size_ - offset_ - 2 ? length : 0;
+}
+
+uint64_t ItchReader::nextTimestamp() const {
+    size_t length = frameLength();
+    if (length < BODY_OFFSET) {
+        return 0;
+    }
+    return loadBigEndian(data_ + offset_ + 2 + TIMESTAMP_OFFSET, 6);
+}
+
+size_t ItchReader::read(vector<Command>& commands, size_t maxCommands, uint64_t until) {
+    size_t appended = 0;
+    while (appended < maxCommands && !done()) {
+        size_t length = frameLength();
+        if (length == 0) {
+            // Truncated tail (or an empty frame): nothing more to decode
+            offset_ = size_;
+            break;
+        }
+        const uint8_t* message = data_ + offset_ + 2;
+        if (until != UINT64_MAX && length >= BODY_OFFSET &&
+            loadBigEndian(message + TIMESTAMP_OFFSET, 6) > until) {
+            break;
+        }
+        offset_ += 2 + length;
+        ++messages_;
+        appended += decode(message, length, commands) ? 1 : 0;
+    }
+    return appended;
+}
+
+const string& ItchReader::symbolFor(const uint8_t* message) {
+    return symbols_[loadBigEndian(message + LOCATE_OFFSET, 2)];
+}
+
+bool ItchReader::decode(const uint8_t* message, size_t length, vector<Command>& commands) {
+    const uint8_t* body = message + BODY_OFFSET;
+    switch (static_cast<char>(message[0])) {
+        case STOCK_DIRECTORY:
+            if (length >= STOCK_DIRECTORY_SIZE) {
+                symbols_[loadBigEndian(message + LOCATE_OFFSET, 2)] = trimStock(body);
+            }
+            return false;
+
+        case ADD_ORDER:
+        case ADD_ORDER_MPID: {
+            if (length < ADD_ORDER_SIZE) {
+                return false;
+            }
+            string& symbol = symbols_[loadBigEndian(message + LOCATE_OFFSET, 2)];
+            if (symbol.empty()) {
+                symbol = trimStock(body + 13);
+            }
+            Order order;
+            order.orderId = loadBigEndian(body, 8);
+            order.side = body[8] == 'S' ? Side::SELL : Side::BUY;
+            order.quantity = static_cast<uint32_t>(loadBigEndian(body + 9, 4));
+            order.symbol = symbol;
+            order.price = static_cast<uint32_t>(loadBigEndian(body + 21, 4));
+            order.type = OrderType::LIMIT;
+            order.timestamp = base_ + nanoseconds(loadBigEndian(message + TIMESTAMP_OFFSET, 6));
+            commands.emplace_back(NewOrder{move(order)});
+            return true;
+        }
+
+        case ORDER_EXECUTED:
+        case ORDER_EXECUTED_WITH_PRICE:
+            if (length < ORDER_EXECUTED_SIZE || symbolFor(message).empty()) {
+                return false;
+            }
+            commands.emplace_back(ReduceOrder{loadBigEndian(body, 8), symbolFor(message),
+                                              static_cast<uint32_t>(loadBigEndian(body + 8, 4))});
+            return true;
+
+        case ORDER_CANCEL:
+            if (length < ORDER_CANCEL_SIZE || symbolFor(message).empty()) {
+                return false;
+            }
+            commands.emplace_back(ReduceOrder{loadBigEndian(body, 8), symbolFor(message),
+                                              static_cast<uint32_t>(loadBigEndian(body + 8, 4))});
+            return true;
+
+        case ORDER_DELETE:
+            if (length < ORDER_DELETE_SIZE || symbolFor(message).empty()) {
+                return false;
+            }
+            commands.emplace_back(CancelOrder{loadBigEndian(body, 8), symbolFor(message)});
+            return true;
+
+        case ORDER_REPLACE:
+            if (length < ORDER_REPLACE_SIZE || symbolFor(message).empty()) {
+                return false;
+            }
+            commands.emplace_back(ReplaceOrder{loadBigEndian(body, 8), loadBigEndian(body + 8, 8),
+                                               symbolFor(message),
+                                               static_cast<uint32_t>(loadBigEndian(body + 20, 4)),
+                                               static_cast<uint32_t>(loadBigEndian(body + 16, 4)),
+                                               base_ + nanoseconds(loadBigEndian(message + TIMESTAMP_OFFSET, 6))});
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+ReplayStats replay(ItchReader& reader, MatchingEngine& engine, ReplayPace pace, size_t batchSize) {
+    ReplayStats stats;
+    vector<Command> commands;
+    commands.reserve(batchSize);
+
+    uint64_t messagesBefore = reader.messagesRead();
+    uint64_t firstTimestamp = reader.done() ? 0 : reader.nextTimestamp();
+    auto start = steady_clock::now();
+
+    while (!reader.done()) {
+        uint64_t until = UINT64_MAX;
+        if (pace == ReplayPace::RECORDED) {
+            until = firstTimestamp + static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+        }
+
+        commands.clear();
+        reader.read(commands, batchSize, until);
+        if (!commands.empty()) {
+            for (const Command& cmd : commands) {
+                stats.newOrders += holds_alternative<NewOrder>(cmd) ? 1 : 0;
+                stats.cancels += holds_alternative<CancelOrder>(cmd) ? 1 : 0;
+                stats.reduces += holds_alternative<ReduceOrder>(cmd) ? 1 : 0;
+                stats.replaces += holds_alternative<ReplaceOrder>(cmd) ? 1 : 0;
+            }
+            engine.processBatch(commands);
+            ++stats.batches;
+        } else if (!reader.done() && reader.nextTimestamp() > until) {
+            this_thread::sleep_until(start + nanoseconds(reader.nextTimestamp() - firstTimestamp));
+        }
+    }
+
+    stats.elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+    stats.messages = reader.messagesRead() - messagesBefore;
+    return stats;
+}
+
+} // namespace feed
+} // namespace tme
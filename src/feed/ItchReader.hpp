@@ -0,0 +1,88 @@
+#pragma once
+
+#include "../core/MatchingEngine.hpp"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tme {
+namespace feed {
+
+using namespace std;
+
+/**
+ * Streams an ITCH-style message file (see ItchFormat.hpp) into Commands.
+ * The file is mapped read-only and decoded in place; the only thing copied
+ * out of a message besides its fields is the symbol, a short string taken
+ * from a per-locate cache.
+ *
+ *   A/F add          -> NewOrder (limit, GTC)
+ *   D delete         -> CancelOrder
+ *   X partial cancel -> ReduceOrder
+ *   E/C executed     -> ReduceOrder (the aggressor isn't in the feed)
+ *   U replace        -> ReplaceOrder
+ *
+ * Other message types only advance the stream; R (stock directory) also
+ * names its locate code. Order timestamps are the feed's, shifted onto
+ * steady_clock at the time the reader was opened.
+ */
+class ItchReader {
+public:
+    explicit ItchReader(const string& path);
+    ~ItchReader();
+
+    ItchReader(const ItchReader&) = delete;
+    ItchReader& operator=(const ItchReader&) = delete;
+
+    // Appends commands until maxCommands were added, the next message is
+    // stamped after `until` (nanoseconds since midnight) or the file ends.
+    // Returns how many commands were appended.
+    size_t read(vector<Command>& commands, size_t maxCommands, uint64_t until = UINT64_MAX);
+
+    bool done() const { return offset_ >= size_; }
+
+    // Feed timestamp of the next message; only meaningful while !done()
+    uint64_t nextTimestamp() const;
+
+    uint64_t messagesRead() const { return messages_; }
+    size_t fileSize() const { return size_; }
+
+private:
+    // Length of the message at offset_, or 0 if the file is truncated there
+    size_t frameLength() const;
+
+    // Appends the command for one message, if any; returns true if it did
+    bool decode(const uint8_t* message, size_t length, vector<Command>& commands);
+
+    const string& symbolFor(const uint8_t* message);
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t offset_ = 0;
+    uint64_t messages_ = 0;
+    chrono::steady_clock::time_point base_;
+    vector<string> symbols_;    // By stock locate; empty until seen
+};
+
+enum class ReplayPace {
+    FULL_SPEED,     // Batches back to back
+    RECORDED        // Each message is released at its feed time
+};
+
+struct ReplayStats {
+    uint64_t messages = 0;
+    uint64_t newOrders = 0;
+    uint64_t cancels = 0;
+    uint64_t reduces = 0;
+    uint64_t replaces = 0;
+    uint64_t batches = 0;
+    chrono::nanoseconds elapsed{0};
+};
+
+// Feeds the rest of the file through engine.processBatch in batches of at
+// most batchSize commands
+ReplayStats replay(ItchReader& reader, MatchingEngine& engine, ReplayPace pace, size_t batchSize);
+
+} // namespace feed
+} // namespace tme
@@ -0,0 +1,92 @@
+#include "ItchWriter.hpp"
+#include "ItchFormat.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace tme {
+namespace feed {
+
+using namespace std;
+using namespace itch;
+
+namespace {
+
+void storeStock(uint8_t* dest, const string& symbol) {
+    memset(dest, ' ', STOCK_SIZE);
+    memcpy(dest, symbol.data(), min(symbol.size(), STOCK_SIZE));
+}
+
+} // namespace
+
+ItchWriter::ItchWriter(const string& path) : out_(path, ios::binary | ios::trunc) {
+    if (!out_) {
+        throw runtime_error("cannot create " + path);
+    }
+}
+
+uint8_t* ItchWriter::begin(char type, size_t size, uint16_t locate, uint64_t timestamp) {
+    memset(buffer_, 0, sizeof(buffer_));
+    storeBigEndian(buffer_, size, 2);
+    uint8_t* message = buffer_ + 2;
+    message[0] = static_cast<uint8_t>(type);
+    storeBigEndian(message + LOCATE_OFFSET, locate, 2);
+    storeBigEndian(message + TIMESTAMP_OFFSET, timestamp, 6);
+    return message + BODY_OFFSET;
+}
+
+void ItchWriter::end(size_t size) {
+    out_.write(reinterpret_cast<const char*>(buffer_), static_cast<streamsize>(2 + size));
+}
+
+void ItchWriter::stockDirectory(uint16_t locate, uint64_t timestamp, const string& symbol) {
+    uint8_t* body = begin(STOCK_DIRECTORY, STOCK_DIRECTORY_SIZE, locate, timestamp);
+    storeStock(body, symbol);
+    end(STOCK_DIRECTORY_SIZE);
+}
+
+void ItchWriter::addOrder(uint16_t locate, uint64_t timestamp, uint64_t orderId, Side side, uint32_t shares,
+                          const string& symbol, uint32_t price) {
+    uint8_t* body = begin(ADD_ORDER, ADD_ORDER_SIZE, locate, timestamp);
+    storeBigEndian(body, orderId, 8);
+    body[8] = side == Side::BUY ? 'B' : 'S';
+    storeBigEndian(body + 9, shares, 4);
+    storeStock(body + 13, symbol);
+    storeBigEndian(body + 21, price, 4);
+    end(ADD_ORDER_SIZE);
+}
+
+void ItchWriter::orderExecuted(uint16_t locate, uint64_t timestamp, uint64_t orderId, uint32_t shares,
+                               uint64_t matchNumber) {
+    uint8_t* body = begin(ORDER_EXECUTED, ORDER_EXECUTED_SIZE, locate, timestamp);
+    storeBigEndian(body, orderId, 8);
+    storeBigEndian(body + 8, shares, 4);
+    storeBigEndian(body + 12, matchNumber, 8);
+    end(ORDER_EXECUTED_SIZE);
+}
+
+void ItchWriter::orderCancel(uint16_t locate, uint64_t timestamp, uint64_t orderId, uint32_t shares) {
+    uint8_t* body = begin(ORDER_CANCEL, ORDER_CANCEL_SIZE, locate, timestamp);
+    storeBigEndian(body, orderId, 8);
+    storeBigEndian(body + 8, shares, 4);
+    end(ORDER_CANCEL_SIZE);
+}
+
+void ItchWriter::orderDelete(uint16_t locate, uint64_t timestamp, uint64_t orderId) {
+    uint8_t* body = begin(ORDER_DELETE, ORDER_DELETE_SIZE, locate, timestamp);
+    storeBigEndian(body, orderId, 8);
+    end(ORDER_DELETE_SIZE);
+}
+
+void ItchWriter::orderReplace(uint16_t locate, uint64_t timestamp, uint64_t orderId, uint64_t newOrderId,
+                              uint32_t shares, uint32_t price) {
+    uint8_t* body = begin(ORDER_REPLACE, ORDER_REPLACE_SIZE, locate, timestamp);
+    storeBigEndian(body, orderId, 8);
+    storeBigEndian(body + 8, newOrderId, 8);
+    storeBigEndian(body + 16, shares, 4);
+    storeBigEndian(body + 20, price, 4);
+    end(ORDER_REPLACE_SIZE);
+}
+
+} // namespace feed
+} // namespace tme
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../core/Order.hpp"
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace tme {
+namespace feed {
+
+using namespace std;
+
+/**
+ * Writes the message types ItchReader decodes, in the same framing, for
+ * sample files and tests. Timestamps are nanoseconds since midnight.
+ * Throws runtime_error if the file can't be created.
+ */
+class ItchWriter {
+public:
+    explicit ItchWriter(const string& path);
+
+    void stockDirectory(uint16_t locate, uint64_t timestamp, const string& symbol);
+    void addOrder(uint16_t locate, uint64_t timestamp, uint64_t orderId, Side side, uint32_t shares,
+                  const string& symbol, uint32_t price);
+    void orderExecuted(uint16_t locate, uint64_t timestamp, uint64_t orderId, uint32_t shares, uint64_t matchNumber);
+    void orderCancel(uint16_t locate, uint64_t timestamp, uint64_t orderId, uint32_t shares);
+    void orderDelete(uint16_t locate, uint64_t timestamp, uint64_t orderId);
+    void orderReplace(uint16_t locate, uint64_t timestamp, uint64_t orderId, uint64_t newOrderId,
+                      uint32_t shares, uint32_t price);
+
+    // Flushes buffered messages; also done on destruction
+    void flush() { out_.flush(); }
+
+private:
+    // Starts a message of `size` bytes with its common header
+    uint8_t* begin(char type, size_t size, uint16_t locate, uint64_t timestamp);
+    void end(size_t size);
+
+    ofstream out_;
+    uint8_t buffer_[2 + 64];
+};
+
+} // namespace feed
+} // namespace tme
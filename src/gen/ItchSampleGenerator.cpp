@@ -0,0 +1,118 @@
+#include "ItchSampleGenerator.hpp"
+#include "../feed/ItchWriter.hpp"
+#include <random>
+#include <vector>
+
+namespace tme {
+namespace gen {
+
+using namespace std;
+using namespace tme::feed;
+
+namespace {
+
+constexpr uint64_t SESSION_OPEN = 34200ULL * 1000000000ULL;   // 09:30:00
+constexpr double MEAN_GAP_NANOS = 2000.0;
+constexpr uint32_t TICK = 100;                                // $0.01 with four decimals
+constexpr uint32_t LOT = 100;
+
+struct LiveOrder {
+    uint64_t orderId;
+    Side side;
+    uint32_t shares;
+    uint32_t price;
+};
+
+} // namespace
+
+void writeItchSample(const string& path, size_t messages, size_t symbols, uint64_t seed) {
+    ItchWriter writer(path);
+    mt19937_64 rng(seed);
+
+    // Zipf-like symbol mix
+    vector<double> weights(symbols);
+    for (size_t i = 0; i < symbols; ++i) {
+        weights[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    discrete_distribution<size_t> symbolDist(weights.begin(), weights.end());
+    exponential_distribution<double> gapDist(1.0 / MEAN_GAP_NANOS);
+    geometric_distribution<uint32_t> levelDist(0.25);    // Ticks behind the touch
+    geometric_distribution<uint32_t> lotsDist(0.5);
+    uniform_real_distribution<double> actionDist(0.0, 1.0);
+
+    vector<string> names(symbols);
+    vector<uint32_t> mids(symbols);
+    vector<vector<LiveOrder>> live(symbols);
+    uint64_t timestamp = SESSION_OPEN;
+    for (size_t i = 0; i < symbols; ++i) {
+        names[i] = "SYM" + to_string(i);
+        mids[i] = 500000 + static_cast<uint32_t>(i) * 1000;
+        writer.stockDirectory(static_cast<uint16_t>(i + 1), timestamp, names[i]);
+    }
+
+    auto priceFor = [&](size_t symbol, Side side, uint32_t ticksBehind) {
+        uint32_t offset = (1 + ticksBehind) * TICK;
+        return side == Side::BUY ? mids[symbol] - offset : mids[symbol] + offset;
+    };
+
+    uint64_t nextOrderId = 1;
+    uint64_t nextMatch = 1;
+    for (size_t m = 0; m < messages; ++m) {
+        timestamp += static_cast<uint64_t>(gapDist(rng)) + 1;
+        size_t s = symbolDist(rng);
+        uint16_t locate = static_cast<uint16_t>(s + 1);
+        vector<LiveOrder>& book = live[s];
+        double action = actionDist(rng);
+
+        if (book.empty() || action < 0.42) {
+            Side side = rng() % 2 ? Side::BUY : Side::SELL;
+            LiveOrder order{nextOrderId++, side, (1 + lotsDist(rng)) * LOT, priceFor(s, side, levelDist(rng))};
+            writer.addOrder(locate, timestamp, order.orderId, side, order.shares, names[s], order.price);
+            book.push_back(order);
+            continue;
+        }
+
+        size_t idx = rng() % book.size();
+        if (action < 0.77) {
+            writer.orderDelete(locate, timestamp, book[idx].orderId);
+            book[idx] = book.back();
+            book.pop_back();
+        } else if (action < 0.85) {
+            uint32_t cancelled = max<uint32_t>(book[idx].shares / 2, 1);
+            writer.orderCancel(locate, timestamp, book[idx].orderId, cancelled);
+            book[idx].shares -= cancelled;
+            if (book[idx].shares == 0) {
+                book[idx] = book.back();
+                book.pop_back();
+            }
+        } else if (action < 0.93) {
+            LiveOrder& order = book[idx];
+            uint64_t newOrderId = nextOrderId++;
+            order.price = priceFor(s, order.side, levelDist(rng));
+            order.shares = (1 + lotsDist(rng)) * LOT;
+            writer.orderReplace(locate, timestamp, order.orderId, newOrderId, order.shares, order.price);
+            order.orderId = newOrderId;
+        } else {
+            // Executions hit the touch: take the closest of a few candidates
+            for (int probe = 0; probe < 4; ++probe) {
+                size_t other = rng() % book.size();
+                auto distance = [&](const LiveOrder& o) {
+                    return o.price > mids[s] ? o.price - mids[s] : mids[s] - o.price;
+                };
+                if (distance(book[other]) < distance(book[idx])) {
+                    idx = other;
+                }
+            }
+            uint32_t executed = min(book[idx].shares, LOT);
+            writer.orderExecuted(locate, timestamp, book[idx].orderId, executed, nextMatch++);
+            book[idx].shares -= executed;
+            if (book[idx].shares == 0) {
+                book[idx] = book.back();
+                book.pop_back();
+            }
+        }
+    }
+}
+
+} // namespace gen
+} // namespace tme
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tme {
+namespace gen {
+
+using namespace std;
+
+// Writes an ITCH-style sample file (see feed/ItchFormat.hpp) of `messages`
+// order messages over `symbols` instruments. Unlike RandomOrderGenerator the
+// flow looks like a real session: a few symbols take most of the traffic,
+// orders queue up within a few ticks of the touch, most of them are
+// cancelled or replaced rather than executed, and nothing crosses (the
+// executions are reported against resting orders, as in the real feed).
+void writeItchSample(const string& path, size_t messages, size_t symbols, uint64_t seed);
+
+} // namespace gen
+} // namespace tme
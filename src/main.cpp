@@ -2,16 +2,26 @@
 #include "gen/RandomOrderGenerator.hpp"
 #include "config/BenchmarkConfig.hpp"
 #include "perf/PerformanceRecorder.hpp"
+#include "bench/ProRataBenchmark.hpp"
+#include "bench/ShmTransportBenchmark.hpp"
+#include "bench/InstrumentMemoryBenchmark.hpp"
+#include "bench/MassCancelBenchmark.hpp"
+#include "bench/ReplicationBenchmark.hpp"
+#include "bench/ItchReplayBenchmark.hpp"
+#include "bench/PositionBenchmark.hpp"
+#include "bench/InterleaveBenchmark.hpp"
+#include "bench/QuoteBenchmark.hpp"
+#include "bench/BatchingBenchmark.hpp"
 #include <iostream>
 #include <iomanip>
 #include <thread>
 #include <chrono>
-#include <random>
 
 using namespace tme;
 using namespace tme::gen;
 using namespace tme::config;
 using namespace tme::perf;
+using namespace tme::bench;
 using namespace std::chrono;
 using namespace std;
 
@@ -34,8 +44,7 @@ void printOrderBookStatus(const shared_ptr<OrderBook>& orderBook) {
 
 // Benchmark orders and record performance metrics
 BenchmarkResult benchmarkAddOrders(MatchingEngine& engine, uint64_t numOrders, uint64_t num_symbols) {
-    random_device rd;
-    RandomOrderGenerator generator(rd(), num_symbols); 
+    RandomOrderGenerator generator(BenchmarkConfig::BENCHMARK_SEED, num_symbols);
     
     cout << "Generating " << numOrders << " orders..." << endl;
     auto genStart = high_resolution_clock::now();
@@ -69,7 +78,54 @@ BenchmarkResult benchmarkAddOrders(MatchingEngine& engine, uint64_t numOrders, u
     return result;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Scenario benchmarks are selected by name; without an argument the
+    // end-to-end throughput benchmark below runs.
+    const string scenario = argc > 1 ? argv[1] : "";
+    if (scenario == "prorata") {
+        runProRataBenchmark();
+        return 0;
+    }
+    if (scenario == "shm") {
+        runShmTransportBenchmark();
+        return 0;
+    }
+    if (scenario == "memory") {
+        runInstrumentMemoryBenchmark();
+        return 0;
+    }
+    if (scenario == "masscancel") {
+        runMassCancelBenchmark();
+        return 0;
+    }
+    if (scenario == "replication") {
+        runReplicationBenchmark();
+        return 0;
+    }
+    if (scenario == "positions") {
+        runPositionBenchmark();
+        return 0;
+    }
+    if (scenario == "interleave") {
+        runInterleaveBenchmark();
+        return 0;
+    }
+    if (scenario == "quotes") {
+        runQuoteBenchmark();
+        return 0;
+    }
+    if (scenario == "batching") {
+        runBatchingBenchmark();
+        return 0;
+    }
+    if (scenario == "itch") {
+        // itch [file] [recorded]
+        string path = argc > 2 && string(argv[2]) != "recorded" ? argv[2] : "";
+        bool recorded = string(argv[argc - 1]) == "recorded";
+        runItchReplayBenchmark(path, recorded);
+        return 0;
+    }
+    
     // Use parallel matching engine with configured number of threads
     MatchingEngine engine(BenchmarkConfig::NUM_THREADS);
     
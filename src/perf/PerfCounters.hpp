@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace tme {
+namespace perf {
+
+using namespace std;
+
+enum class Counter {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,     // L1 data cache read misses
+    LLC_MISSES,     // Last level cache misses
+    BRANCH_MISSES,
+    COUNT
+};
+
+/**
+ * Hardware counters read through perf_event_open, user space only. Each
+ * counter is opened on its own with inherit set, so threads the caller
+ * creates afterwards (e.g. engine workers) are counted too; open it before
+ * starting them. Counters the kernel or the sandbox refuses are simply
+ * unavailable, and the others keep working.
+ *
+ * Values are scaled for multiplexing when the PMU is oversubscribed.
+ */
+class PerfCounters {
+public:
+    static constexpr size_t COUNT = static_cast<size_t>(Counter::COUNT);
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Resets and enables every available counter
+    void start();
+
+    // Disables the counters and latches their values for read()
+    void stop();
+
+    bool available(Counter counter) const { return fds_[index(counter)] >= 0; }
+    bool anyAvailable() const;
+
+    // Value latched by the last stop(); 0 if unavailable
+    uint64_t read(Counter counter) const { return values_[index(counter)]; }
+
+    static const char* name(Counter counter);
+
+private:
+    static size_t index(Counter counter) { return static_cast<size_t>(counter); }
+
+    array<int, COUNT> fds_;
+    array<uint64_t, COUNT> values_{};
+};
+
+} // namespace perf
+} // namespace tme
@@ -0,0 +1,369 @@
+#include "Replication.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace tme {
+namespace repl {
+
+using namespace std;
+using transport::CommandRecord;
+
+namespace {
+
+runtime_error systemError(const string& what) {
+    return runtime_error(what + ": " + strerror(errno));
+}
+
+// Batches are small writes that must not wait for Nagle
+void setNoDelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// Writes every iovec completely. A follower that went away is reported as
+// an error rather than a SIGPIPE.
+void writeAll(int fd, iovec* iov, int count) {
+    while (count > 0) {
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = static_cast<size_t>(count);
+        ssize_t written = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw systemError("replication write");
+        }
+        size_t left = static_cast<size_t>(written);
+        while (count > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+}
+
+// Returns false on a clean end of stream before the first byte
+bool readAll(int fd, void* data, size_t size) {
+    char* cursor = static_cast<char*>(data);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t got = read(fd, cursor + done, size - done);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw systemError("replication read");
+        }
+        if (got == 0) {
+            if (done == 0) {
+                return false;
+            }
+            throw runtime_error("replication stream truncated");
+        }
+        done += static_cast<size_t>(got);
+    }
+    return true;
+}
+
+int connectTo(const string& host, uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    int rc = getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &addresses);
+    if (rc != 0) {
+        throw runtime_error("getaddrinfo " + host + ": " + gai_strerror(rc));
+    }
+
+    int fd = -1;
+    for (addrinfo* a = addresses; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0) {
+        throw systemError("connect " + host + ":" + to_string(port));
+    }
+    setNoDelay(fd);
+    return fd;
+}
+
+} // namespace
+
+ReplicationPrimary::ReplicationPrimary(MatchingEngine& engine, const string& host, uint16_t port,
+                                       size_t maxInFlight)
+    : engine_(engine), socket_(connectTo(host, port)), maxInFlight_(max<size_t>(maxInFlight, 1)) {
+    engine_.setSequencedExpiry(true);
+    ackReader_ = thread(&ReplicationPrimary::ackLoop, this);
+}
+
+ReplicationPrimary::~ReplicationPrimary() {
+    // Closing our write side lets the follower finish; it then closes too,
+    // which ends the ack reader
+    shutdown(socket_, SHUT_WR);
+    ackReader_.join();
+    close(socket_);
+}
+
+uint64_t ReplicationPrimary::processBatch(const vector<Command>& commands) {
+    lock_guard<mutex> sendLock(sendMutex_);
+    records_.clear();
+    for (const Command& cmd : commands) {
+        encode(cmd);
+    }
+    uint64_t sequence = send(BatchKind::COMMANDS);
+
+    // The follower applies the same batch while we do
+    engine_.processBatch(commands);
+    return sequence;
+}
+
+MassQuoteAck ReplicationPrimary::processMassQuote(const MassQuote& massQuote) {
+    lock_guard<mutex> sendLock(sendMutex_);
+    records_.clear();
+    encode(massQuote);
+    send(BatchKind::MASS_QUOTE);
+    return engine_.processMassQuote(massQuote);
+}
+
+bool ReplicationPrimary::cancelOrder(uint64_t orderId, const string& symbol) {
+    lock_guard<mutex> sendLock(sendMutex_);
+    records_.clear();
+    encode(CancelOrder{orderId, symbol});
+    send(BatchKind::COMMANDS);
+    return engine_.cancelOrder(orderId, symbol);
+}
+
+void ReplicationPrimary::setSessionClose(chrono::steady_clock::time_point sessionClose) {
+    lock_guard<mutex> sendLock(sendMutex_);
+    records_.clear();
+    send(BatchKind::SESSION_CLOSE, sinceEpoch(sessionClose));
+    engine_.setSessionClose(sessionClose);
+}
+
+void ReplicationPrimary::compactIdleBooks() {
+    lock_guard<mutex> sendLock(sendMutex_);
+    records_.clear();
+    send(BatchKind::COMPACT);
+    engine_.compactIdleBooks();
+}
+
+void ReplicationPrimary::expireOrders(chrono::steady_clock::time_point now) {
+    lock_guard<mutex> sendLock(sendMutex_);
+    records_.clear();
+    send(BatchKind::EXPIRE_ORDERS, sinceEpoch(now));
+    engine_.expireOrders(now);
+}
+
+void ReplicationPrimary::encode(const Command& cmd) {
+    size_t first = records_.size();
+    if (const auto* massQuote = get_if<MassQuote>(&cmd)) {
+        // Its quotes are applied within the same batch on the follower
+        for (const Quote& quote : massQuote->quotes) {
+            records_.push_back(transport::toRecord(quote));
+        }
+    } else {
+        records_.push_back(transport::toRecord(cmd));
+    }
+
+    // toRecord writes times from the steady_clock epoch; send them from
+    // the engine's
+    int64_t engineEpoch = chrono::duration_cast<chrono::nanoseconds>(engine_.epoch().time_since_epoch()).count();
+    for (size_t i = first; i < records_.size(); ++i) {
+        records_[i].timestampNanos -= engineEpoch;
+        records_[i].expireTimeNanos -= engineEpoch;
+    }
+}
+
+uint64_t ReplicationPrimary::send(BatchKind kind, int64_t timeNanos) {
+    uint64_t sequence = sentSequence_.load(memory_order_relaxed) + 1;
+
+    // Back-pressure: bound the follower's lag
+    {
+        unique_lock<mutex> lock(ackMutex_);
+        ackCondition_.wait(lock, [&] {
+            return disconnected_ || sequence - ackedSequence_.load(memory_order_relaxed) <= maxInFlight_;
+        });
+        if (disconnected_) {
+            throw runtime_error("replication follower disconnected");
+        }
+    }
+
+    for (CommandRecord& record : records_) {
+        record.sequence = sequence;
+    }
+
+    BatchHeader header{BATCH_MAGIC, sequence, static_cast<uint32_t>(records_.size()), kind, timeNanos};
+    iovec iov[2] = {{&header, sizeof(header)}, {records_.data(), records_.size() * sizeof(CommandRecord)}};
+    writeAll(socket_, iov, records_.empty() ? 1 : 2);
+    sentSequence_.store(sequence, memory_order_release);
+    return sequence;
+}
+
+int64_t ReplicationPrimary::sinceEpoch(chrono::steady_clock::time_point time) const {
+    return chrono::duration_cast<chrono::nanoseconds>(time - engine_.epoch()).count();
+}
+
+void ReplicationPrimary::waitForAck(uint64_t sequence) {
+    unique_lock<mutex> lock(ackMutex_);
+    ackCondition_.wait(lock, [&] {
+        return disconnected_ || ackedSequence_.load(memory_order_relaxed) >= sequence;
+    });
+    if (ackedSequence_.load(memory_order_relaxed) < sequence) {
+        throw runtime_error("replication follower disconnected");
+    }
+}
+
+void ReplicationPrimary::ackLoop() {
+    BatchAck ack;
+    try {
+        while (readAll(socket_, &ack, sizeof(ack))) {
+            {
+                lock_guard<mutex> lock(ackMutex_);
+                ackedSequence_.store(ack.sequence, memory_order_release);
+            }
+            ackCondition_.notify_all();
+        }
+    } catch (...) {
+        // A broken connection is reported to waiters as a disconnect
+    }
+    {
+        lock_guard<mutex> lock(ackMutex_);
+        disconnected_ = true;
+    }
+    ackCondition_.notify_all();
+}
+
+ReplicationFollower::ReplicationFollower(MatchingEngine& engine, uint16_t port) : engine_(engine) {
+    engine_.setSequencedExpiry(true);
+    listenSocket_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket_ < 0) {
+        throw systemError("socket");
+    }
+    int one = 1;
+    setsockopt(listenSocket_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    socklen_t length = sizeof(address);
+    if (bind(listenSocket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenSocket_, 1) != 0 ||
+        getsockname(listenSocket_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        int error = errno;
+        close(listenSocket_);
+        errno = error;
+        throw systemError("listen on port " + to_string(port));
+    }
+    port_ = ntohs(address.sin_port);
+}
+
+ReplicationFollower::~ReplicationFollower() {
+    close(listenSocket_);
+}
+
+uint64_t ReplicationFollower::run() {
+    int fd = accept(listenSocket_, nullptr, nullptr);
+    if (fd < 0) {
+        throw systemError("accept");
+    }
+    setNoDelay(fd);
+
+    uint64_t applied = 0;
+    try {
+        BatchHeader header;
+        while (readAll(fd, &header, sizeof(header))) {
+            if (header.magic != BATCH_MAGIC || header.sequence != applied + 1) {
+                throw runtime_error("replication stream out of sequence at batch " + to_string(applied + 1));
+            }
+            records_.resize(header.count);
+            if (header.count > 0 && !readAll(fd, records_.data(), header.count * sizeof(CommandRecord))) {
+                throw runtime_error("replication stream truncated");
+            }
+
+            apply(header);
+            applied = header.sequence;
+
+            BatchAck ack{applied};
+            iovec iov{&ack, sizeof(ack)};
+            writeAll(fd, &iov, 1);
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return applied;
+}
+
+void ReplicationFollower::apply(const BatchHeader& header) {
+    switch (header.kind) {
+    case BatchKind::EXPIRE_ORDERS:
+        engine_.expireOrders(fromEpoch(header.timeNanos));
+        return;
+    case BatchKind::SESSION_CLOSE:
+        engine_.setSessionClose(fromEpoch(header.timeNanos));
+        return;
+    case BatchKind::COMPACT:
+        engine_.compactIdleBooks();
+        return;
+    case BatchKind::COMMANDS:
+    case BatchKind::MASS_QUOTE:
+        break;
+    default:
+        throw runtime_error("replication batch " + to_string(header.sequence) + " has an unknown kind");
+    }
+
+    commands_.clear();
+    for (const CommandRecord& record : records_) {
+        if (!transport::isValid(record)) {
+            continue;   // Rejected at the primary's ingress as well
+        }
+        commands_.push_back(transport::toCommand(record));
+        // Replay the primary's times exactly, even an unset timestamp, so
+        // both engines see the same time priority and expiry ticks
+        auto timestamp = fromEpoch(record.timestampNanos);
+        if (auto* newOrder = get_if<NewOrder>(&commands_.back())) {
+            newOrder->order.timestamp = timestamp;
+            newOrder->order.expireTime = fromEpoch(record.expireTimeNanos);
+        } else if (auto* replace = get_if<ReplaceOrder>(&commands_.back())) {
+            replace->timestamp = timestamp;
+        } else if (auto* quote = get_if<Quote>(&commands_.back())) {
+            quote->timestamp = timestamp;
+        }
+    }
+
+    if (header.kind == BatchKind::COMMANDS) {
+        engine_.processBatch(commands_);
+        return;
+    }
+    MassQuote massQuote;
+    for (Command& cmd : commands_) {
+        massQuote.quotes.push_back(move(get<Quote>(cmd)));
+    }
+    engine_.processMassQuote(massQuote);
+}
+
+chrono::steady_clock::time_point ReplicationFollower::fromEpoch(int64_t nanos) const {
+    return engine_.epoch() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::nanoseconds(nanos));
+}
+
+} // namespace repl
+} // namespace tme
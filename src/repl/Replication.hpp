@@ -0,0 +1,155 @@
+#pragma once
+
+#include "../core/MatchingEngine.hpp"
+#include "../transport/TransportRecords.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tme {
+namespace repl {
+
+using namespace std;
+
+// What the follower does with a batch
+enum class BatchKind : uint32_t {
+    COMMANDS = 0,           // processBatch of its records
+    MASS_QUOTE = 1,         // processMassQuote of its QUOTE records
+    EXPIRE_ORDERS = 2,      // expireOrders at timeNanos
+    SESSION_CLOSE = 3,      // setSessionClose to timeNanos
+    COMPACT = 4             // compactIdleBooks
+};
+
+// Every batch on the wire is a BatchHeader followed by `count`
+// transport::CommandRecords; the follower answers each applied batch with
+// a BatchAck carrying its sequence.
+//
+// Times, in the header and in the records' timestampNanos and
+// expireTimeNanos, are nanoseconds from the sending engine's epoch; the
+// follower adds them to its own.
+struct BatchHeader {
+    uint64_t magic;
+    uint64_t sequence;      // 1, 2, 3... per primary
+    uint32_t count;
+    BatchKind kind;
+    int64_t timeNanos;
+};
+
+struct BatchAck {
+    uint64_t sequence;
+};
+
+constexpr uint64_t BATCH_MAGIC = 0x544d455245504c33ULL;  // "TMEREPL3"
+
+/**
+ * Primary side of a hot-standby pair. Every batch is numbered, written to
+ * the follower's TCP connection and then applied to the local engine
+ * without waiting for the follower, so replication overlaps with matching.
+ * Acks are read on a background thread; the primary only blocks once
+ * maxInFlight batches are unacknowledged.
+ *
+ * Everything that changes the books has to go through the primary, not
+ * the engine. The engine is switched to sequenced expiry, so GTD/DAY
+ * orders only expire when expireOrders is called here; call it
+ * periodically.
+ */
+class ReplicationPrimary {
+public:
+    ReplicationPrimary(MatchingEngine& engine, const string& host, uint16_t port, size_t maxInFlight = 64);
+    ~ReplicationPrimary();
+
+    ReplicationPrimary(const ReplicationPrimary&) = delete;
+    ReplicationPrimary& operator=(const ReplicationPrimary&) = delete;
+
+    // Replicates and applies a batch; returns its sequence number.
+    // Concurrent calls are serialised, with each other and with the calls
+    // below.
+    uint64_t processBatch(const vector<Command>& commands);
+
+    // Replicated forms of the MatchingEngine calls of the same name
+    MassQuoteAck processMassQuote(const MassQuote& massQuote);
+    bool cancelOrder(uint64_t orderId, const string& symbol);
+    void setSessionClose(chrono::steady_clock::time_point sessionClose);
+    void compactIdleBooks();
+
+    // Expires what is due at `now` on both engines
+    void expireOrders(chrono::steady_clock::time_point now = chrono::steady_clock::now());
+
+    // Blocks until the follower has applied the batch with this sequence.
+    // Throws if the follower disconnected first.
+    void waitForAck(uint64_t sequence);
+
+    uint64_t lastSentSequence() const { return sentSequence_.load(memory_order_acquire); }
+    uint64_t lastAckedSequence() const { return ackedSequence_.load(memory_order_acquire); }
+
+private:
+    void ackLoop();
+
+    // Appends the records for one command, with times made relative to
+    // the engine epoch
+    void encode(const Command& cmd);
+
+    // Numbers records_ as the next batch and writes it; sendMutex_ must
+    // be held. Returns its sequence.
+    uint64_t send(BatchKind kind, int64_t timeNanos = 0);
+
+    int64_t sinceEpoch(chrono::steady_clock::time_point time) const;
+
+    MatchingEngine& engine_;
+    int socket_;
+    size_t maxInFlight_;
+
+    // Serialises processBatch so sequence order equals apply order
+    mutex sendMutex_;
+    vector<transport::CommandRecord> records_;
+    atomic<uint64_t> sentSequence_{0};
+
+    mutex ackMutex_;
+    condition_variable ackCondition_;
+    atomic<uint64_t> ackedSequence_{0};
+    bool disconnected_ = false;
+    thread ackReader_;
+};
+
+/**
+ * Follower side: listens for one primary and applies its batches, in
+ * sequence order, to its engine before acking them.
+ *
+ * Orders keep the primary's timestamps, so fills price the same on both
+ * engines. The engine is switched to sequenced expiry and only expires
+ * orders, and moves its session close, where the primary's stream says so.
+ */
+class ReplicationFollower {
+public:
+    // Binds and listens right away; port 0 picks a free port
+    ReplicationFollower(MatchingEngine& engine, uint16_t port);
+    ~ReplicationFollower();
+
+    ReplicationFollower(const ReplicationFollower&) = delete;
+    ReplicationFollower& operator=(const ReplicationFollower&) = delete;
+
+    uint16_t port() const { return port_; }
+
+    // Accepts a primary and applies its stream until it disconnects.
+    // Returns the last sequence applied.
+    uint64_t run();
+
+private:
+    // Applies one batch read from the primary
+    void apply(const BatchHeader& header);
+
+    chrono::steady_clock::time_point fromEpoch(int64_t nanos) const;
+
+    MatchingEngine& engine_;
+    int listenSocket_;
+    uint16_t port_;
+    vector<transport::CommandRecord> records_;
+    vector<Command> commands_;
+};
+
+} // namespace repl
+} // namespace tme
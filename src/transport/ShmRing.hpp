@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+namespace tme {
+namespace transport {
+
+using namespace std;
+
+/**
+ * Bounded multi-producer/multi-consumer ring of fixed-size records laid out
+ * in caller-provided memory, so it can live in a shared mapping and be used
+ * from several processes. Each slot carries a sequence number that tells
+ * producers and consumers whose turn it is; a push or pop is one CAS on the
+ * shared cursor plus one release store, with no syscalls.
+ */
+template <typename T>
+class ShmRing {
+    static_assert(is_trivially_copyable<T>::value, "ring records are copied between processes");
+    static_assert(atomic<uint64_t>::is_always_lock_free, "ring cursors must be address-free");
+
+public:
+    struct Header {
+        uint64_t capacity;
+        alignas(64) atomic<uint64_t> enqueuePos;
+        alignas(64) atomic<uint64_t> dequeuePos;
+    };
+
+    struct alignas(64) Slot {
+        atomic<uint64_t> sequence;
+        T value;
+    };
+
+    ShmRing() = default;
+
+    // Bytes needed for a ring of `capacity` records (a power of two)
+    static size_t bytesFor(size_t capacity) {
+        return sizeof(Header) + capacity * sizeof(Slot);
+    }
+
+    // Lays out an empty ring at `memory`, which must be 64-byte aligned
+    static ShmRing initialize(void* memory, size_t capacity) {
+        Header* header = new (memory) Header;
+        header->capacity = capacity;
+        header->enqueuePos.store(0, memory_order_relaxed);
+        header->dequeuePos.store(0, memory_order_relaxed);
+
+        Slot* slots = reinterpret_cast<Slot*>(header + 1);
+        for (size_t i = 0; i < capacity; ++i) {
+            Slot* slot = new (&slots[i]) Slot;
+            slot->sequence.store(i, memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_release);
+        return ShmRing(header);
+    }
+
+    // Uses a ring another process already initialised
+    static ShmRing attach(void* memory) {
+        return ShmRing(static_cast<Header*>(memory));
+    }
+
+    bool tryPush(const T& value) {
+        uint64_t pos = header_->enqueuePos.load(memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            uint64_t seq = slot.sequence.load(memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (header_->enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // Full
+            } else {
+                pos = header_->enqueuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Pushes all `count` values into consecutive slots, or none of them when
+    // fewer are free. A single consumer then pops them back to back, with
+    // no other producer's record in between.
+    bool tryPushAll(const T* values, size_t count) {
+        if (count == 0) {
+            return true;
+        }
+        uint64_t pos = header_->enqueuePos.load(memory_order_relaxed);
+        for (;;) {
+            int64_t diff = 0;
+            for (size_t i = 0; i < count && diff == 0; ++i) {
+                uint64_t seq = slots_[(pos + i) & mask_].sequence.load(memory_order_acquire);
+                diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + i);
+            }
+            if (diff == 0) {
+                if (header_->enqueuePos.compare_exchange_weak(pos, pos + count, memory_order_relaxed)) {
+                    for (size_t i = 0; i < count; ++i) {
+                        Slot& slot = slots_[(pos + i) & mask_];
+                        slot.value = values[i];
+                        slot.sequence.store(pos + i + 1, memory_order_release);
+                    }
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // Not enough room
+            } else {
+                pos = header_->enqueuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        uint64_t pos = header_->dequeuePos.load(memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            uint64_t seq = slot.sequence.load(memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
+            if (diff == 0) {
+                if (header_->dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    value = slot.value;
+                    slot.sequence.store(pos + mask_ + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // Empty
+            } else {
+                pos = header_->dequeuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Releases the next slot when a producer claimed it but never wrote
+    // it, so the ring behind it can drain; returns false if it isn't such
+    // a slot. Only for a single consumer, and only once the producer that
+    // claimed the slot is known to be gone.
+    bool skipUnwritten() {
+        uint64_t pos = header_->dequeuePos.load(memory_order_relaxed);
+        Slot& slot = slots_[pos & mask_];
+        if (slot.sequence.load(memory_order_acquire) != pos ||
+            header_->enqueuePos.load(memory_order_acquire) <= pos) {
+            return false;
+        }
+        slot.sequence.store(pos + mask_ + 1, memory_order_release);
+        header_->dequeuePos.store(pos + 1, memory_order_relaxed);
+        return true;
+    }
+
+    size_t capacity() const { return static_cast<size_t>(mask_ + 1); }
+
+    // Records claimed but not yet popped; a snapshot that concurrent
+    // producers and consumers overtake
+    size_t size() const {
+        uint64_t dequeued = header_->dequeuePos.load(memory_order_acquire);
+        uint64_t enqueued = header_->enqueuePos.load(memory_order_acquire);
+        return enqueued > dequeued ? static_cast<size_t>(enqueued - dequeued) : 0;
+    }
+
+private:
+    explicit ShmRing(Header* header)
+        : header_(header), slots_(reinterpret_cast<Slot*>(header + 1)), mask_(header->capacity - 1) {}
+
+    Header* header_ = nullptr;
+    Slot* slots_ = nullptr;
+    uint64_t mask_ = 0;
+};
+
+} // namespace transport
+} // namespace tme
@@ -0,0 +1,378 @@
+#include "ShmTransport.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tme {
+namespace transport {
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t SEGMENT_MAGIC = 0x544d4553484d3032ULL;  // "TMESHM02"
+
+size_t alignUp(size_t value) {
+    return (value + 63) & ~size_t{63};
+}
+
+bool isPowerOfTwo(size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+runtime_error systemError(const string& what, const string& name) {
+    return runtime_error(what + " " + name + ": " + strerror(errno));
+}
+
+bool processAlive(int32_t pid) {
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+} // namespace
+
+struct alignas(64) ShmSegment::Header {
+    atomic<uint64_t> magic;
+    uint64_t commandCapacity;
+    uint64_t responseCapacity;
+    uint32_t maxProducers;
+};
+
+// The slot table follows the header
+struct ShmSegment::ProducerSlot {
+    atomic<int32_t> owner;          // pid, 0 when free
+    atomic<uint32_t> generation;
+};
+
+unique_ptr<ShmSegment> ShmSegment::create(const string& name, const ShmConfig& config) {
+    if (!isPowerOfTwo(config.commandCapacity) || !isPowerOfTwo(config.responseCapacity) ||
+        config.maxProducers == 0) {
+        throw invalid_argument("ring capacities must be powers of two and maxProducers non-zero");
+    }
+
+    size_t size = alignUp(sizeof(Header)) + alignUp(config.maxProducers * sizeof(ProducerSlot)) +
+                  alignUp(ShmRing<CommandRecord>::bytesFor(config.commandCapacity)) +
+                  config.maxProducers * alignUp(ShmRing<ResponseRecord>::bytesFor(config.responseCapacity));
+
+    // A segment left behind by a crashed engine is replaced
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw systemError("shm_open", name);
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw systemError("ftruncate", name);
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw systemError("mmap", name);
+    }
+
+    Header* header = new (base) Header;
+    header->commandCapacity = config.commandCapacity;
+    header->responseCapacity = config.responseCapacity;
+    header->maxProducers = config.maxProducers;
+
+    char* cursor = static_cast<char*>(base) + alignUp(sizeof(Header));
+    auto* slots = reinterpret_cast<ProducerSlot*>(cursor);
+    for (uint32_t i = 0; i < config.maxProducers; ++i) {
+        ProducerSlot* slot = new (&slots[i]) ProducerSlot;
+        slot->owner.store(0, memory_order_relaxed);
+        slot->generation.store(0, memory_order_relaxed);
+    }
+    cursor += alignUp(config.maxProducers * sizeof(ProducerSlot));
+    ShmRing<CommandRecord>::initialize(cursor, config.commandCapacity);
+    cursor += alignUp(ShmRing<CommandRecord>::bytesFor(config.commandCapacity));
+    for (uint32_t i = 0; i < config.maxProducers; ++i) {
+        ShmRing<ResponseRecord>::initialize(cursor, config.responseCapacity);
+        cursor += alignUp(ShmRing<ResponseRecord>::bytesFor(config.responseCapacity));
+    }
+
+    // Gateways only attach once the magic is visible
+    header->magic.store(SEGMENT_MAGIC, memory_order_release);
+
+    return unique_ptr<ShmSegment>(new ShmSegment(name, base, size, true));
+}
+
+unique_ptr<ShmSegment> ShmSegment::open(const string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        throw systemError("shm_open", name);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw systemError("fstat", name);
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        throw systemError("mmap", name);
+    }
+
+    auto* header = static_cast<Header*>(base);
+    if (size < sizeof(Header) || header->magic.load(memory_order_acquire) != SEGMENT_MAGIC) {
+        munmap(base, size);
+        throw runtime_error("shared memory segment " + name + " is not initialised");
+    }
+
+    return unique_ptr<ShmSegment>(new ShmSegment(name, base, size, false));
+}
+
+ShmSegment::ShmSegment(const string& name, void* base, size_t size, bool owner)
+    : name_(name), base_(base), size_(size), owner_(owner), header_(static_cast<Header*>(base)),
+      slots_(reinterpret_cast<ProducerSlot*>(static_cast<char*>(base) + alignUp(sizeof(Header)))) {
+    attachRings();
+}
+
+ShmSegment::~ShmSegment() {
+    munmap(base_, size_);
+    if (owner_) {
+        shm_unlink(name_.c_str());
+    }
+}
+
+void ShmSegment::attachRings() {
+    char* cursor = static_cast<char*>(base_) + alignUp(sizeof(Header)) +
+                   alignUp(header_->maxProducers * sizeof(ProducerSlot));
+    commands_ = ShmRing<CommandRecord>::attach(cursor);
+    cursor += alignUp(ShmRing<CommandRecord>::bytesFor(header_->commandCapacity));
+
+    responses_.reserve(header_->maxProducers);
+    for (uint32_t i = 0; i < header_->maxProducers; ++i) {
+        responses_.push_back(ShmRing<ResponseRecord>::attach(cursor));
+        cursor += alignUp(ShmRing<ResponseRecord>::bytesFor(header_->responseCapacity));
+    }
+}
+
+uint32_t ShmSegment::registerProducer() {
+    int32_t self = static_cast<int32_t>(getpid());
+
+    // Free slots first; only then take over the slot of a dead gateway
+    for (bool reclaim : {false, true}) {
+        for (uint32_t id = 0; id < header_->maxProducers; ++id) {
+            ProducerSlot& slot = slots_[id];
+            int32_t owner = slot.owner.load(memory_order_acquire);
+            if (owner != 0 && (!reclaim || processAlive(owner))) {
+                continue;
+            }
+            if (slot.owner.compare_exchange_strong(owner, self, memory_order_acq_rel)) {
+                slot.generation.fetch_add(1, memory_order_acq_rel);
+                return id;
+            }
+        }
+    }
+    throw runtime_error("shared memory segment " + name_ + " has no free producer slot");
+}
+
+void ShmSegment::releaseProducer(uint32_t producerId) {
+    slots_[producerId].owner.store(0, memory_order_release);
+}
+
+uint32_t ShmSegment::producerGeneration(uint32_t producerId) const {
+    return slots_[producerId].generation.load(memory_order_acquire);
+}
+
+bool ShmSegment::producerActive(uint32_t producerId, uint32_t generation) const {
+    if (producerId >= header_->maxProducers) {
+        return false;
+    }
+    int32_t owner = slots_[producerId].owner.load(memory_order_acquire);
+    return owner != 0 && producerGeneration(producerId) == generation && processAlive(owner);
+}
+
+uint32_t ShmSegment::maxProducers() const {
+    return header_->maxProducers;
+}
+
+ShmGatewayClient::ShmGatewayClient(const string& name)
+    : segment_(ShmSegment::open(name)), producerId_(segment_->registerProducer()),
+      generation_(segment_->producerGeneration(producerId_)) {
+    // Whatever a previous owner left unread is not ours
+    ResponseRecord stale;
+    while (segment_->responses(producerId_).tryPop(stale)) {
+    }
+}
+
+ShmGatewayClient::~ShmGatewayClient() {
+    segment_->releaseProducer(producerId_);
+}
+
+bool ShmGatewayClient::trySend(const Command& cmd) {
+    records_.clear();
+    appendRecords(cmd, records_);
+    if (records_.size() > segment_->commands().capacity()) {
+        throw invalid_argument("mass quote of " + to_string(records_.size() - 1) +
+                               " quotes does not fit the command ring");
+    }
+
+    int64_t sendTimeNanos = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+    for (CommandRecord& record : records_) {
+        record.producerId = producerId_;
+        record.producerGeneration = generation_;
+        record.sequence = nextSequence_;
+        record.sendTimeNanos = sendTimeNanos;
+    }
+
+    if (!segment_->commands().tryPushAll(records_.data(), records_.size())) {
+        return false;
+    }
+    ++nextSequence_;
+    return true;
+}
+
+uint64_t ShmGatewayClient::send(const Command& cmd) {
+    uint64_t sequence = nextSequence_;
+    while (!trySend(cmd)) {
+        // Ring full: the engine is behind, keep retrying
+    }
+    return sequence;
+}
+
+bool ShmGatewayClient::pollResponse(ResponseRecord& response) {
+    while (segment_->responses(producerId_).tryPop(response)) {
+        if (response.producerGeneration == generation_) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ShmCommandReceiver::ShmCommandReceiver(MatchingEngine& engine, const string& name, const ShmConfig& config)
+    : engine_(engine), segment_(ShmSegment::create(name, config)), massQuoteWait_(config.massQuoteWait) {}
+
+size_t ShmCommandReceiver::poll(size_t maxBatch) {
+    records_.clear();
+    commands_.clear();
+
+    // Whatever follows an unfinished mass quote in the ring is behind it
+    if (assembling_ && !assembleMassQuote()) {
+        return 0;
+    }
+
+    size_t limit = min(maxBatch, batching_.batchSize(segment_->commands().size()));
+    CommandRecord record;
+    while (records_.size() < limit && segment_->commands().tryPop(record)) {
+        // A QUOTE record outside a mass quote lost its header
+        if (!isValid(record) || record.type == RecordType::QUOTE) {
+            respond(record, ResponseStatus::REJECTED);
+            ++rejectedRecords_;
+            continue;
+        }
+        if (record.type == RecordType::MASS_QUOTE) {
+            assembling_ = true;
+            malformedQuote_ = false;
+            senderLost_ = false;
+            massQuoteHeader_ = record;
+            massQuote_.quotes.clear();
+            if (!assembleMassQuote()) {
+                break;
+            }
+            continue;
+        }
+        records_.push_back(record);
+        commands_.push_back(toCommand(record));
+    }
+    if (records_.empty()) {
+        return 0;
+    }
+
+    auto start = chrono::steady_clock::now();
+    engine_.processBatch(commands_);
+    batching_.record(commands_.size(), chrono::steady_clock::now() - start);
+
+    for (const CommandRecord& applied : records_) {
+        respond(applied, ResponseStatus::ACCEPTED);
+    }
+
+    return records_.size();
+}
+
+bool ShmCommandReceiver::assembleMassQuote() {
+    // The quotes were claimed together with the header and sit right
+    // behind it; the sender may still be writing them
+    auto deadline = chrono::steady_clock::now() + massQuoteWait_;
+    CommandRecord quote;
+    while (massQuote_.quotes.size() < massQuoteHeader_.quantity) {
+        if (segment_->commands().tryPop(quote)) {
+            if (quote.producerId != massQuoteHeader_.producerId || quote.sequence != massQuoteHeader_.sequence) {
+                // The header claimed more quotes than were sent with it
+                rejectMassQuote();
+                respond(quote, ResponseStatus::REJECTED);
+                ++rejectedRecords_;
+                return true;
+            }
+            if (quote.type == RecordType::QUOTE) {
+                massQuote_.quotes.push_back(get<Quote>(toCommand(quote)));
+            } else {
+                // Still consumed, so the framing holds
+                malformedQuote_ = true;
+                massQuote_.quotes.emplace_back();
+            }
+            continue;
+        }
+        if (chrono::steady_clock::now() < deadline) {
+            continue;
+        }
+        if (segment_->commands().size() == 0) {
+            return rejectMassQuote();     // Nothing else was claimed with it
+        }
+        if (segment_->producerActive(massQuoteHeader_.producerId, massQuoteHeader_.producerGeneration)) {
+            return false;
+        }
+
+        // The sender is gone: release the next slot if it claimed it but
+        // never wrote it, and drop the mass quote once all are consumed
+        if (segment_->commands().skipUnwritten()) {
+            senderLost_ = true;
+            massQuote_.quotes.emplace_back();
+        }
+    }
+
+    if (senderLost_) {
+        ++droppedMassQuotes_;
+        assembling_ = false;
+        return true;
+    }
+    if (malformedQuote_) {
+        return rejectMassQuote();
+    }
+    assembling_ = false;
+    records_.push_back(massQuoteHeader_);
+    commands_.push_back(move(massQuote_));
+    massQuote_ = MassQuote();
+    return true;
+}
+
+bool ShmCommandReceiver::rejectMassQuote() {
+    respond(massQuoteHeader_, ResponseStatus::REJECTED);
+    ++rejectedRecords_;
+    assembling_ = false;
+    return true;
+}
+
+void ShmCommandReceiver::respond(const CommandRecord& record, ResponseStatus status) {
+    if (record.producerId >= segment_->maxProducers()) {
+        return;
+    }
+    ResponseRecord response{record.sequence, record.orderId, record.sendTimeNanos, record.producerGeneration,
+                            status};
+    if (!segment_->responses(record.producerId).tryPush(response)) {
+        ++droppedResponses_;
+    }
+}
+
+} // namespace transport
+} // namespace tme
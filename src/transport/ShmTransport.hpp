@@ -0,0 +1,175 @@
+#pragma once
+
+#include "ShmRing.hpp"
+#include "TransportRecords.hpp"
+#include "../core/BatchController.hpp"
+#include "../core/MatchingEngine.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tme {
+namespace transport {
+
+using namespace std;
+
+struct ShmConfig {
+    size_t commandCapacity = 1 << 16;    // Shared command ring, power of two
+    size_t responseCapacity = 1 << 14;   // Each producer's response ring, power of two
+    uint32_t maxProducers = 8;
+
+    // How long one receiver poll waits for the rest of a mass quote
+    chrono::microseconds massQuoteWait{100};
+};
+
+/**
+ * A POSIX shared memory segment holding one multi-producer command ring and
+ * one response ring per producer slot. The engine creates (and finally
+ * unlinks) the segment; gateway processes open it by name and claim a
+ * slot, which they give back when they detach. A slot whose owning process
+ * died is reclaimed by the next gateway that finds no free one.
+ */
+class ShmSegment {
+public:
+    static unique_ptr<ShmSegment> create(const string& name, const ShmConfig& config = ShmConfig());
+    static unique_ptr<ShmSegment> open(const string& name);
+    ~ShmSegment();
+
+    ShmSegment(const ShmSegment&) = delete;
+    ShmSegment& operator=(const ShmSegment&) = delete;
+
+    ShmRing<CommandRecord>& commands() { return commands_; }
+    ShmRing<ResponseRecord>& responses(uint32_t producerId) { return responses_[producerId]; }
+
+    // Claims a free producer slot, or one whose owner died, and returns
+    // its id; throws when all are taken
+    uint32_t registerProducer();
+    void releaseProducer(uint32_t producerId);
+    uint32_t maxProducers() const;
+
+    // Bumped every time the slot is claimed, so records of a previous
+    // owner can be told apart
+    uint32_t producerGeneration(uint32_t producerId) const;
+
+    // Whether the slot is still held, by a live process, in that generation
+    bool producerActive(uint32_t producerId, uint32_t generation) const;
+
+private:
+    struct Header;
+    struct ProducerSlot;
+
+    ShmSegment(const string& name, void* base, size_t size, bool owner);
+    void attachRings();
+
+    string name_;
+    void* base_;
+    size_t size_;
+    bool owner_;
+    Header* header_;
+    ProducerSlot* slots_;
+    ShmRing<CommandRecord> commands_;
+    vector<ShmRing<ResponseRecord>> responses_;
+};
+
+/**
+ * Gateway side: publishes commands into the shared ring and reads back the
+ * acknowledgements addressed to this producer. A MassQuote is published as
+ * its MASS_QUOTE header and QUOTE records in consecutive slots, all or
+ * nothing, and acknowledged once.
+ */
+class ShmGatewayClient {
+public:
+    explicit ShmGatewayClient(const string& name);
+
+    // Gives the producer slot back
+    ~ShmGatewayClient();
+
+    ShmGatewayClient(const ShmGatewayClient&) = delete;
+    ShmGatewayClient& operator=(const ShmGatewayClient&) = delete;
+
+    // Returns false without blocking when the command ring is full. Throws
+    // invalid_argument for a MassQuote with more records than the ring holds.
+    bool trySend(const Command& cmd);
+
+    // Spins until the command is published; returns its sequence number
+    uint64_t send(const Command& cmd);
+
+    // Skips acknowledgements meant for a previous owner of the slot
+    bool pollResponse(ResponseRecord& response);
+
+    uint32_t producerId() const { return producerId_; }
+
+private:
+    unique_ptr<ShmSegment> segment_;
+    uint32_t producerId_;
+    uint32_t generation_;
+    uint64_t nextSequence_ = 1;
+    vector<CommandRecord> records_;
+};
+
+/**
+ * Engine side: drains the command ring straight into
+ * MatchingEngine::processBatch and acknowledges each command on its
+ * producer's response ring. Polling only touches shared memory. How much
+ * one poll drains is sized by a BatchController from the ring's depth and
+ * the measured processBatch time.
+ *
+ * Records are checked before they reach the engine; a malformed one is
+ * answered REJECTED. A mass quote is drained as one unit: its header and
+ * every QUOTE record behind it become a single MassQuote. A poll waits at
+ * most massQuoteWait for quotes still being written and resumes on the
+ * next poll. If their sender is gone by then, the partial mass quote is
+ * dropped and the slots it never wrote are released.
+ */
+class ShmCommandReceiver {
+public:
+    ShmCommandReceiver(MatchingEngine& engine, const string& name, const ShmConfig& config = ShmConfig());
+
+    // Applies queued commands as one batch, at most maxBatch and at most
+    // what the batching controller allows; returns how many
+    size_t poll(size_t maxBatch);
+
+    void setBatching(const BatchingConfig& config) { batching_.configure(config); }
+
+    // Current drain size and processBatch service times
+    BatchStats batchStats() const { return batching_.stats(); }
+
+    // Acks dropped because a producer stopped reading its response ring
+    uint64_t droppedResponses() const { return droppedResponses_; }
+
+    // Malformed records and mass quotes answered REJECTED
+    uint64_t rejectedRecords() const { return rejectedRecords_; }
+
+    // Mass quotes whose sender died before writing all of them
+    uint64_t droppedMassQuotes() const { return droppedMassQuotes_; }
+
+private:
+    // Collects the quotes of the mass quote being assembled. Returns false
+    // while some are still missing and their sender is alive.
+    bool assembleMassQuote();
+    bool rejectMassQuote();
+
+    void respond(const CommandRecord& record, ResponseStatus status);
+
+    MatchingEngine& engine_;
+    unique_ptr<ShmSegment> segment_;
+    chrono::microseconds massQuoteWait_;
+    vector<CommandRecord> records_;     // One per command, acknowledged after the batch
+    vector<Command> commands_;
+    BatchController batching_;
+    uint64_t droppedResponses_ = 0;
+    uint64_t rejectedRecords_ = 0;
+    uint64_t droppedMassQuotes_ = 0;
+
+    // Mass quote being assembled across polls
+    bool assembling_ = false;
+    bool malformedQuote_ = false;
+    bool senderLost_ = false;
+    CommandRecord massQuoteHeader_{};
+    MassQuote massQuote_;
+};
+
+} // namespace transport
+} // namespace tme
@@ -0,0 +1,175 @@
+#include "TransportRecords.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace tme {
+namespace transport {
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+void copySymbol(char (&dest)[SYMBOL_CAPACITY], const string& symbol) {
+    // A truncated symbol could name another instrument
+    if (symbol.size() > SYMBOL_CAPACITY) {
+        throw invalid_argument("symbol " + symbol + " is longer than " + to_string(SYMBOL_CAPACITY) + " bytes");
+    }
+    memset(dest, 0, SYMBOL_CAPACITY);
+    memcpy(dest, symbol.data(), symbol.size());
+}
+
+string readSymbol(const char (&src)[SYMBOL_CAPACITY]) {
+    const char* end = static_cast<const char*>(memchr(src, '\0', SYMBOL_CAPACITY));
+    return string(src, end ? end : src + SYMBOL_CAPACITY);
+}
+
+steady_clock::time_point toTimePoint(int64_t nanos) {
+    return steady_clock::time_point(duration_cast<steady_clock::duration>(nanoseconds(nanos)));
+}
+
+} // namespace
+
+CommandRecord toRecord(const Command& cmd) {
+    CommandRecord record{};
+
+    if (const auto* newOrder = get_if<NewOrder>(&cmd)) {
+        const Order& order = newOrder->order;
+        record.type = RecordType::NEW_ORDER;
+        record.orderId = order.orderId;
+        record.price = order.price;
+        record.quantity = order.quantity;
+        record.account = order.account;
+        record.displayQuantity = order.displayQuantity;
+        record.side = static_cast<uint8_t>(order.side);
+        record.orderType = static_cast<uint8_t>(order.type);
+        record.timeInForce = static_cast<uint8_t>(order.timeInForce);
+        record.timestampNanos = duration_cast<nanoseconds>(order.timestamp.time_since_epoch()).count();
+        record.expireTimeNanos = duration_cast<nanoseconds>(order.expireTime.time_since_epoch()).count();
+        copySymbol(record.symbol, order.symbol);
+    } else if (const auto* cancel = get_if<CancelOrder>(&cmd)) {
+        record.type = RecordType::CANCEL_ORDER;
+        record.orderId = cancel->orderId;
+        copySymbol(record.symbol, cancel->symbol);
+    } else if (const auto* massCancel = get_if<MassCancel>(&cmd)) {
+        record.type = RecordType::MASS_CANCEL;
+        record.account = massCancel->account;
+        record.side = massCancel->side ? static_cast<uint8_t>(*massCancel->side) : BOTH_SIDES;
+        copySymbol(record.symbol, massCancel->symbol);
+    } else if (const auto* reduce = get_if<ReduceOrder>(&cmd)) {
+        record.type = RecordType::REDUCE_ORDER;
+        record.orderId = reduce->orderId;
+        record.quantity = reduce->quantity;
+        copySymbol(record.symbol, reduce->symbol);
+    } else if (const auto* quote = get_if<Quote>(&cmd)) {
+        record.type = RecordType::QUOTE;
+        record.account = quote->account;
+        record.price = quote->bidPrice;
+        record.quantity = quote->bidQuantity;
+        record.askPrice = quote->askPrice;
+        record.askQuantity = quote->askQuantity;
+        record.timestampNanos = duration_cast<nanoseconds>(quote->timestamp.time_since_epoch()).count();
+        copySymbol(record.symbol, quote->symbol);
+    } else if (holds_alternative<MassQuote>(cmd)) {
+        throw invalid_argument("a MassQuote is sent as one QUOTE record per instrument");
+    } else {
+        const auto& replace = get<ReplaceOrder>(cmd);
+        record.type = RecordType::REPLACE_ORDER;
+        record.orderId = replace.orderId;
+        record.newOrderId = replace.newOrderId;
+        record.price = replace.price;
+        record.quantity = replace.quantity;
+        record.timestampNanos = duration_cast<nanoseconds>(replace.timestamp.time_since_epoch()).count();
+        copySymbol(record.symbol, replace.symbol);
+    }
+
+    return record;
+}
+
+void appendRecords(const Command& cmd, vector<CommandRecord>& records) {
+    const auto* massQuote = get_if<MassQuote>(&cmd);
+    if (!massQuote) {
+        records.push_back(toRecord(cmd));
+        return;
+    }
+    CommandRecord header{};
+    header.type = RecordType::MASS_QUOTE;
+    header.quantity = static_cast<uint32_t>(massQuote->quotes.size());
+    records.push_back(header);
+    for (const Quote& quote : massQuote->quotes) {
+        records.push_back(toRecord(quote));
+    }
+}
+
+bool isValid(const CommandRecord& record) {
+    switch (record.type) {
+    case RecordType::NEW_ORDER:
+        return !isQuoteOrderId(record.orderId) && record.side <= static_cast<uint8_t>(Side::SELL) &&
+               record.orderType <= static_cast<uint8_t>(OrderType::STOP_LIMIT) &&
+               record.timeInForce <= static_cast<uint8_t>(TimeInForce::GTD);
+    case RecordType::MASS_CANCEL:
+        return record.side <= static_cast<uint8_t>(Side::SELL) || record.side == BOTH_SIDES;
+    case RecordType::CANCEL_ORDER:
+    case RecordType::REDUCE_ORDER:
+        return !isQuoteOrderId(record.orderId);
+    case RecordType::REPLACE_ORDER:
+        return !isQuoteOrderId(record.orderId) && !isQuoteOrderId(record.newOrderId);
+    case RecordType::QUOTE:
+        return record.account != 0;
+    case RecordType::MASS_QUOTE:
+        return true;
+    }
+    return false;
+}
+
+Command toCommand(const CommandRecord& record) {
+    if (!isValid(record)) {
+        throw invalid_argument("malformed command record of type " + to_string(static_cast<int>(record.type)));
+    }
+    if (record.type == RecordType::MASS_QUOTE) {
+        throw invalid_argument("a MASS_QUOTE header is decoded together with its QUOTE records");
+    }
+    if (record.type == RecordType::CANCEL_ORDER) {
+        return CancelOrder{record.orderId, readSymbol(record.symbol)};
+    }
+    if (record.type == RecordType::MASS_CANCEL) {
+        optional<Side> side;
+        if (record.side != BOTH_SIDES) {
+            side = static_cast<Side>(record.side);
+        }
+        return MassCancel{record.account, readSymbol(record.symbol), side};
+    }
+    if (record.type == RecordType::REDUCE_ORDER) {
+        return ReduceOrder{record.orderId, readSymbol(record.symbol), record.quantity};
+    }
+    if (record.type == RecordType::REPLACE_ORDER) {
+        auto timestamp = record.timestampNanos != 0 ? toTimePoint(record.timestampNanos) : steady_clock::now();
+        return ReplaceOrder{record.orderId, record.newOrderId, readSymbol(record.symbol), record.price,
+                            record.quantity, timestamp};
+    }
+
+    if (record.type == RecordType::QUOTE) {
+        auto timestamp = record.timestampNanos != 0 ? toTimePoint(record.timestampNanos) : steady_clock::now();
+        return Quote{record.account, readSymbol(record.symbol), record.price, record.quantity,
+                     record.askPrice, record.askQuantity, timestamp};
+    }
+
+    Order order;
+    order.orderId = record.orderId;
+    order.symbol = readSymbol(record.symbol);
+    order.price = record.price;
+    order.quantity = record.quantity;
+    order.side = static_cast<Side>(record.side);
+    order.type = static_cast<OrderType>(record.orderType);
+    order.timestamp = record.timestampNanos != 0 ? toTimePoint(record.timestampNanos) : steady_clock::now();
+    order.account = record.account;
+    order.displayQuantity = record.displayQuantity;
+    order.timeInForce = static_cast<TimeInForce>(record.timeInForce);
+    order.expireTime = toTimePoint(record.expireTimeNanos);
+    return NewOrder{order};
+}
+
+} // namespace transport
+} // namespace tme
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "../core/Command.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace tme {
+namespace transport {
+
+using namespace std;
+
+// Room for a 21-character OCC option symbol
+constexpr size_t SYMBOL_CAPACITY = 24;
+
+enum class RecordType : uint8_t {
+    NEW_ORDER = 1,
+    CANCEL_ORDER = 2,
+    MASS_CANCEL = 3,
+    REDUCE_ORDER = 4,
+    REPLACE_ORDER = 5,
+    QUOTE = 6,
+    MASS_QUOTE = 7
+};
+
+// `side` value of a MASS_CANCEL record that covers both sides
+constexpr uint8_t BOTH_SIDES = 0xFF;
+
+/**
+ * Fixed-size, pointer-free encoding of a Command. Symbols longer than
+ * SYMBOL_CAPACITY are rejected; a shorter one is NUL-padded.
+ *
+ * A QUOTE record carries its bid in price/quantity. A MassQuote travels
+ * as a MASS_QUOTE header whose quantity counts the QUOTE records, one per
+ * instrument, that directly follow it (see appendRecords).
+ */
+struct CommandRecord {
+    uint64_t sequence;          // Per-producer, assigned by the sender
+    uint64_t orderId;
+    uint64_t newOrderId;        // REPLACE_ORDER only
+    int64_t sendTimeNanos;      // steady_clock at send, echoed in the response
+    int64_t timestampNanos;     // steady_clock order time; 0 = stamp on arrival
+    int64_t expireTimeNanos;    // steady_clock, GTD only
+    uint32_t producerId;
+    uint32_t producerGeneration;    // Of the producer's slot, echoed in the response
+    uint32_t price;
+    uint32_t quantity;
+    uint32_t account;
+    uint32_t displayQuantity;   // NEW_ORDER only; iceberg slice, 0 = all
+    uint32_t askPrice;          // QUOTE only
+    uint32_t askQuantity;       // QUOTE only
+    RecordType type;
+    uint8_t side;
+    uint8_t orderType;
+    uint8_t timeInForce;
+    char symbol[SYMBOL_CAPACITY];
+};
+
+enum class ResponseStatus : uint8_t {
+    ACCEPTED = 1,
+    REJECTED = 2    // Malformed record, never applied
+};
+
+// Acknowledgement sent back to the producer once a command was applied
+struct ResponseRecord {
+    uint64_t sequence;
+    uint64_t orderId;
+    int64_t sendTimeNanos;
+    uint32_t producerGeneration;
+    ResponseStatus status;
+};
+
+// Throws invalid_argument for a MassQuote (see appendRecords) and for a
+// symbol longer than SYMBOL_CAPACITY
+CommandRecord toRecord(const Command& cmd);
+
+// Appends the records of any command: its one record, or a MassQuote's
+// MASS_QUOTE header followed by its QUOTE records
+void appendRecords(const Command& cmd, vector<CommandRecord>& records);
+
+// Whether toCommand can decode the record: a known type and, where the
+// type uses them, side, order type and time in force in range, no order id
+// in the reserved quote range and an account on a quote
+bool isValid(const CommandRecord& record);
+
+// Throws invalid_argument for a record that is not isValid and for a
+// MASS_QUOTE header, which is decoded together with its quotes
+Command toCommand(const CommandRecord& record);
+
+} // namespace transport
+} // namespace tme
@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+#include "../src/core/BatchController.hpp"
+#include "../src/core/CommandBatcher.hpp"
+#include "../src/core/MatchingEngine.hpp"
+#include <thread>
+
+using namespace tme;
+using namespace std::chrono;
+
+TEST(BatchControllerTest, SizesFromServiceTimeAndBacklog) {
+    BatchingConfig config;
+    config.latencyTarget = microseconds(10);
+    config.minBatch = 2;
+    config.maxBatch = 500;
+    BatchController controller(config);
+    
+    // Nothing timed yet
+    EXPECT_EQ(controller.batchSize(0), 100);
+    
+    // 100ns per item fits 100 items in 10us
+    controller.record(50, nanoseconds(5000));
+    EXPECT_EQ(controller.batchSize(0), 100);
+    EXPECT_EQ(controller.batchSize(80), 100);
+    
+    // A backlog that can't be served within the target is taken whole, up to maxBatch
+    EXPECT_EQ(controller.batchSize(300), 300);
+    EXPECT_EQ(controller.batchSize(5000), 500);
+    
+    // Slower items shrink the batch, but never below minBatch
+    for (int i = 0; i < 100; ++i) {
+        controller.record(10, microseconds(100));
+    }
+    EXPECT_EQ(controller.batchSize(0), 2);
+    
+    BatchStats stats = controller.stats();
+    EXPECT_EQ(stats.batches, 101);
+    EXPECT_EQ(stats.items, 1050);
+    EXPECT_EQ(stats.batchSize, 2);
+    EXPECT_NEAR(stats.itemNanos, 10000, 1);
+    
+    // A fixed size ignores both
+    controller.configure(BatchingConfig{microseconds(10), 100, 100});
+    EXPECT_EQ(controller.batchSize(0), 100);
+    EXPECT_EQ(controller.batchSize(5000), 100);
+}
+
+namespace {
+
+Order limitOrder(uint64_t id, Side side, uint32_t price, uint32_t quantity, uint32_t account) {
+    Order order;
+    order.orderId = id;
+    order.symbol = "B";
+    order.price = price;
+    order.quantity = quantity;
+    order.side = side;
+    order.type = OrderType::LIMIT;
+    order.account = account;
+    return order;
+}
+
+} // namespace
+
+TEST(MatchingEngineTest, FillsDoNotDependOnBatchSize) {
+    // The sell trades with the buy at 101 that was there first; the buy at
+    // 102 arrives after it and rests, however the commands are batched
+    vector<Command> commands = {NewOrder{limitOrder(1, Side::BUY, 101, 10, 1)},
+                                NewOrder{limitOrder(2, Side::SELL, 100, 10, 2)},
+                                NewOrder{limitOrder(3, Side::BUY, 102, 10, 3)}};
+    
+    MatchingEngine together(1);
+    together.processBatch(commands);
+    MatchingEngine oneByOne(1);
+    for (const Command& cmd : commands) {
+        oneByOne.processBatch({cmd});
+    }
+    
+    for (MatchingEngine* engine : {&together, &oneByOne}) {
+        EXPECT_EQ(engine->accountExposure(1).boughtQuantity, 10);
+        EXPECT_DOUBLE_EQ(engine->accountExposure(2).netNotional, -1010);
+        EXPECT_EQ(engine->accountExposure(3).boughtQuantity, 0);
+        EXPECT_EQ(engine->getOrderBook("B")->getBestBid(), 102);
+    }
+}
+
+TEST(CommandBatcherTest, AppliesSubmissionsInOrderAndFlushes) {
+    MatchingEngine engine(2);
+    size_t applied = 0;
+    CommandBatcher batcher(engine, BatchingConfig{microseconds(10), 3, 3},
+                           [&](const vector<Command>& batch) { applied += batch.size(); });
+    
+    thread producer([&] {
+        for (uint64_t i = 1; i <= 20; ++i) {
+            batcher.submit(NewOrder{limitOrder(i, Side::BUY, 100, 1, 0)});
+        }
+    });
+    producer.join();
+    batcher.submit({CancelOrder{1, "B"}, CancelOrder{2, "B"}});
+    batcher.flush();
+    
+    EXPECT_EQ(applied, 22);
+    EXPECT_EQ(engine.getOrderBook("B")->getVolumeAtPrice(Side::BUY, 100), 18);
+    BatchStats stats = batcher.batchStats();
+    EXPECT_EQ(stats.items, 22);
+    EXPECT_GE(stats.batches, 8);    // No batch is larger than 3
+}
@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+#include "../src/feed/ItchReader.hpp"
+#include "../src/feed/ItchWriter.hpp"
+#include <cstdio>
+#include <unistd.h>
+
+using namespace tme;
+using namespace tme::feed;
+
+TEST(ItchReaderTest, DecodesOrderMessagesAndReplaysThem) {
+    const string path = "/tmp/tme_itch_test_" + to_string(getpid()) + ".bin";
+    {
+        ItchWriter writer(path);
+        writer.stockDirectory(7, 1000, "MSFT");
+        writer.addOrder(7, 2000, 1, Side::BUY, 300, "MSFT", 1000000);
+        writer.addOrder(7, 3000, 2, Side::BUY, 200, "MSFT", 1000000);
+        writer.addOrder(7, 4000, 3, Side::SELL, 100, "MSFT", 1010000);
+        writer.orderCancel(7, 5000, 1, 100);
+        writer.orderExecuted(7, 6000, 1, 50, 1);
+        writer.orderReplace(7, 7000, 2, 4, 400, 999900);
+        writer.orderDelete(7, 8000, 3);
+    }
+    
+    ItchReader reader(path);
+    vector<Command> commands;
+    EXPECT_EQ(reader.read(commands, 100, 4000), 3);
+    EXPECT_EQ(reader.nextTimestamp(), 5000);
+    EXPECT_EQ(reader.read(commands, 100), 4);
+    EXPECT_TRUE(reader.done());
+    EXPECT_EQ(reader.messagesRead(), 8);
+    
+    ASSERT_EQ(commands.size(), 7);
+    const Order& add = get<NewOrder>(commands[0]).order;
+    EXPECT_EQ(add.symbol, "MSFT");
+    EXPECT_EQ(add.quantity, 300);
+    EXPECT_EQ(add.price, 1000000);
+    EXPECT_EQ(get<NewOrder>(commands[2]).order.side, Side::SELL);
+    EXPECT_EQ(get<ReduceOrder>(commands[3]).quantity, 100);
+    EXPECT_EQ(get<ReduceOrder>(commands[4]).quantity, 50);
+    EXPECT_EQ(get<ReplaceOrder>(commands[5]).newOrderId, 4);
+    EXPECT_EQ(get<ReplaceOrder>(commands[5]).price, 999900);
+    EXPECT_EQ(get<CancelOrder>(commands[6]).orderId, 3);
+    
+    ItchReader replayed(path);
+    MatchingEngine engine(2);
+    ReplayStats stats = replay(replayed, engine, ReplayPace::FULL_SPEED, 2);
+    EXPECT_EQ(stats.newOrders, 3);
+    EXPECT_EQ(stats.reduces, 2);
+    EXPECT_EQ(stats.replaces, 1);
+    EXPECT_EQ(stats.cancels, 1);
+    
+    auto book = engine.getOrderBook("MSFT");
+    ASSERT_TRUE(book != nullptr);
+    EXPECT_EQ(book->getVolumeAtPrice(Side::BUY, 1000000), 150);
+    EXPECT_EQ(book->getVolumeAtPrice(Side::BUY, 999900), 400);
+    EXPECT_EQ(book->getBestAsk(), 0);
+    EXPECT_EQ(book->orderCount(), 2);
+    
+    remove(path.c_str());
+}
@@ -62,8 +62,8 @@ TEST(OrderBookTest, MatchOrders) {
     
     // Check that the orders were matched
     EXPECT_EQ(matches.size(), 1);
-    EXPECT_EQ(matches[0].first.orderId, 1);
-    EXPECT_EQ(matches[0].second.orderId, 2);
+    EXPECT_EQ(matches[0].buy.orderId, 1);
+    EXPECT_EQ(matches[0].sell.orderId, 2);
     
     // Check that the buy order still has 5 shares left
     EXPECT_EQ(orderBook.getVolumeAtPrice(Side::BUY, 100.0), 5);
@@ -95,3 +95,604 @@ TEST(MatchingEngineTest, ProcessOrders) {
     EXPECT_EQ(orderBook->getBestBid(), 100.0);
     EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 100.0), 10);
 }
+
+TEST(OrderBookTest, SingleWriterBookMatchesLikeDefault) {
+    OrderBook orderBook("AAPL", BookConfig{MatchingMode::FIFO, LockingMode::NONE});
+    
+    Order buyOrder;
+    buyOrder.orderId = 1;
+    buyOrder.symbol = "AAPL";
+    buyOrder.price = 101;
+    buyOrder.quantity = 10;
+    buyOrder.side = Side::BUY;
+    buyOrder.type = OrderType::LIMIT;
+    
+    Order sellOrder = buyOrder;
+    sellOrder.orderId = 2;
+    sellOrder.price = 100;
+    sellOrder.quantity = 4;
+    sellOrder.side = Side::SELL;
+    
+    orderBook.addOrdersBatch({buyOrder, sellOrder});
+    auto matches = orderBook.matchOrders();
+    
+    ASSERT_EQ(matches.size(), 1);
+    EXPECT_EQ(orderBook.getBestBid(), 101);
+    EXPECT_EQ(orderBook.getBestAsk(), 0);
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::BUY, 101), 6);
+}
+
+TEST(OrderBookTest, BasicBookOrdersLevelsBySide) {
+    BasicOrderBook<FifoMatching, NoLocking> orderBook("ES");
+    
+    Order order;
+    order.symbol = "ES";
+    order.quantity = 1;
+    order.type = OrderType::LIMIT;
+    
+    order.side = Side::BUY;
+    for (uint32_t price : {10, 30, 20}) {
+        order.orderId = price;
+        order.price = price;
+        orderBook.addOrder(order);
+    }
+    order.side = Side::SELL;
+    for (uint32_t price : {60, 40, 50}) {
+        order.orderId = price;
+        order.price = price;
+        orderBook.addOrder(order);
+    }
+    
+    EXPECT_EQ(orderBook.getBestBid(), 30);
+    EXPECT_EQ(orderBook.getBestAsk(), 40);
+    EXPECT_TRUE(orderBook.cancelOrder(30));
+    EXPECT_EQ(orderBook.getBestBid(), 20);
+    EXPECT_TRUE(orderBook.matchOrders().empty());
+}
+
+TEST(MatchingEngineTest, ConfigureInstrumentBeforeFirstOrder) {
+    MatchingEngine engine;
+    
+    EXPECT_TRUE(engine.configureInstrument("MSFT", BookConfig{MatchingMode::FIFO, LockingMode::NONE}));
+    EXPECT_FALSE(engine.configureInstrument("MSFT", BookConfig()));
+    
+    // Registered instruments stay compact until their first order
+    EXPECT_TRUE(engine.getOrderBook("MSFT") == nullptr);
+    
+    Order order;
+    order.orderId = 1;
+    order.symbol = "MSFT";
+    order.price = 300;
+    order.quantity = 1;
+    order.side = Side::BUY;
+    order.type = OrderType::LIMIT;
+    engine.processOrder(order);
+    
+    // Only its worker may touch a single-writer book, so it isn't handed
+    // out; a cancel still reaches it through the shard
+    EXPECT_TRUE(engine.getOrderBook("MSFT") == nullptr);
+    EXPECT_TRUE(engine.cancelOrder(1, "MSFT"));
+    EXPECT_FALSE(engine.cancelOrder(1, "MSFT"));
+    EXPECT_FALSE(engine.cancelOrder(1, "UNKNOWN"));
+    EXPECT_EQ(engine.instrumentCount(), 1);
+}
+
+namespace {
+
+Order makeOrder(uint64_t id, Side side, uint32_t price, uint32_t quantity, uint32_t account = 0) {
+    Order order;
+    order.orderId = id;
+    order.symbol = "ES";
+    order.price = price;
+    order.quantity = quantity;
+    order.side = side;
+    order.type = OrderType::LIMIT;
+    order.account = account;
+    return order;
+}
+
+} // namespace
+
+TEST(OrderBookTest, ProRataSplitsLevelBySizeWithRemainderInTimePriority) {
+    OrderBook orderBook("ES", BookConfig{MatchingMode::PRO_RATA, LockingMode::NONE});
+    
+    orderBook.addOrdersBatch({makeOrder(1, Side::BUY, 100, 10),
+                              makeOrder(2, Side::BUY, 100, 30),
+                              makeOrder(3, Side::BUY, 100, 60),
+                              makeOrder(4, Side::SELL, 100, 7)});
+    auto fills = orderBook.matchOrders();
+    
+    // 0.7 / 2.1 / 4.2 round down to 0 / 2 / 4; the spare lot goes to the oldest order
+    ASSERT_EQ(fills.size(), 3);
+    EXPECT_EQ(fills[0].buy.orderId, 1);
+    EXPECT_EQ(fills[0].quantity, 1);
+    EXPECT_EQ(fills[1].buy.orderId, 2);
+    EXPECT_EQ(fills[1].quantity, 2);
+    EXPECT_EQ(fills[2].buy.orderId, 3);
+    EXPECT_EQ(fills[2].quantity, 4);
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::BUY, 100), 93);
+    EXPECT_EQ(orderBook.getBestAsk(), 0);
+}
+
+TEST(OrderBookTest, AllocationPoliciesPriceFillsAtTheEarlierOrder) {
+    for (MatchingMode mode : {MatchingMode::FIFO, MatchingMode::PRO_RATA, MatchingMode::FIFO_LMM}) {
+        // The smaller sell level rests first, so it sets the price
+        OrderBook restingSell("ES", BookConfig{mode, LockingMode::NONE});
+        restingSell.addOrder(makeOrder(1, Side::SELL, 100, 5));
+        restingSell.addOrder(makeOrder(2, Side::BUY, 105, 10));
+        auto fills = restingSell.matchOrders();
+        ASSERT_EQ(fills.size(), 1);
+        EXPECT_EQ(fills[0].price, 100) << static_cast<int>(mode);
+        
+        // The larger buy level rests first and sets the price
+        OrderBook restingBuy("ES", BookConfig{mode, LockingMode::NONE});
+        restingBuy.addOrder(makeOrder(1, Side::BUY, 105, 10));
+        restingBuy.addOrder(makeOrder(2, Side::SELL, 100, 5));
+        fills = restingBuy.matchOrders();
+        ASSERT_EQ(fills.size(), 1);
+        EXPECT_EQ(fills[0].price, 105) << static_cast<int>(mode);
+    }
+}
+
+TEST(OrderBookTest, FifoLmmAllocatesLeadMarketMakerShareFirst) {
+    BookConfig config{MatchingMode::FIFO_LMM, LockingMode::NONE};
+    config.lmmAccount = 7;
+    config.lmmAllocationPercent = 40;
+    OrderBook orderBook("ES", config);
+    
+    orderBook.addOrdersBatch({makeOrder(1, Side::BUY, 100, 10, 1),
+                              makeOrder(2, Side::BUY, 100, 10, 7),
+                              makeOrder(3, Side::SELL, 100, 10, 2)});
+    auto fills = orderBook.matchOrders();
+    
+    ASSERT_EQ(fills.size(), 2);
+    EXPECT_EQ(fills[0].buy.orderId, 1);
+    EXPECT_EQ(fills[0].quantity, 6);
+    EXPECT_EQ(fills[1].buy.orderId, 2);
+    EXPECT_EQ(fills[1].quantity, 4);
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::BUY, 100), 10);
+    
+    // Order 1 is down to 4 lots, order 2 still has 6
+    EXPECT_TRUE(orderBook.cancelOrder(2));
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::BUY, 100), 4);
+}
+
+TEST(OrderBookTest, FifoLmmRejectsAShareForAccountZero) {
+    BookConfig config{MatchingMode::FIFO_LMM, LockingMode::NONE};
+    config.lmmAllocationPercent = 40;
+    EXPECT_THROW(OrderBook("ES", config), invalid_argument);
+    
+    // Without a share there is no lead market maker to name
+    config.lmmAllocationPercent = 0;
+    EXPECT_NO_THROW(OrderBook("ES", config));
+}
+
+TEST(OrderBookTest, AllocationPoliciesTreatTheLaterLevelAsTheAggressor) {
+    for (MatchingMode mode : {MatchingMode::PRO_RATA, MatchingMode::FIFO_LMM}) {
+        BookConfig config{mode, LockingMode::NONE};
+        config.lmmAccount = 7;
+        config.lmmAllocationPercent = 40;
+        OrderBook orderBook("ES", config);
+        
+        // The smaller bid level rests first; the larger sell level crosses it
+        // and is consumed in time order, not allocated across
+        orderBook.addOrdersBatch({makeOrder(1, Side::BUY, 100, 10, 1),
+                                  makeOrder(2, Side::BUY, 100, 10, 7),
+                                  makeOrder(3, Side::SELL, 100, 15, 2),
+                                  makeOrder(4, Side::SELL, 100, 25, 3)});
+        auto fills = orderBook.matchOrders();
+        
+        uint32_t soldBy3 = 0;
+        uint32_t soldBy4 = 0;
+        for (const Fill& fill : fills) {
+            (fill.sell.orderId == 3 ? soldBy3 : soldBy4) += fill.quantity;
+        }
+        EXPECT_EQ(soldBy3, 15) << static_cast<int>(mode);
+        EXPECT_EQ(soldBy4, 5) << static_cast<int>(mode);
+        EXPECT_EQ(orderBook.getBestBid(), 0) << static_cast<int>(mode);
+        EXPECT_EQ(orderBook.getVolumeAtPrice(Side::SELL, 100), 20) << static_cast<int>(mode);
+        EXPECT_FALSE(orderBook.cancelOrder(3)) << static_cast<int>(mode);
+        EXPECT_TRUE(orderBook.cancelOrder(4)) << static_cast<int>(mode);
+    }
+}
+
+TEST(MatchingEngineTest, GoodTillDateOrdersExpire) {
+    MatchingEngine engine(2);
+    auto now = chrono::steady_clock::now();
+    
+    Order gtd = makeOrder(1, Side::BUY, 100, 10);
+    gtd.timeInForce = TimeInForce::GTD;
+    gtd.expireTime = now + chrono::milliseconds(20);
+    Order gtc = makeOrder(2, Side::BUY, 99, 10);
+    Order stale = makeOrder(3, Side::BUY, 98, 10);
+    stale.timeInForce = TimeInForce::GTD;
+    stale.expireTime = now - chrono::milliseconds(1);
+    
+    engine.processBatch({NewOrder{gtd}, NewOrder{gtc}, NewOrder{stale}});
+    auto orderBook = engine.getOrderBook("ES");
+    ASSERT_TRUE(orderBook != nullptr);
+    EXPECT_EQ(orderBook->getBestBid(), 100);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 98), 0);  // Expired on arrival
+    
+    this_thread::sleep_for(chrono::milliseconds(30));
+    engine.expireOrders();
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 100), 0);
+    EXPECT_EQ(orderBook->getBestBid(), 99);
+}
+
+TEST(MatchingEngineTest, CancelCommandAppliesInOrderAndDropsExpiry) {
+    MatchingEngine engine(2);
+    engine.setSessionClose(chrono::steady_clock::now() + chrono::hours(1));
+    
+    Order day = makeOrder(1, Side::SELL, 105, 10);
+    day.timeInForce = TimeInForce::DAY;
+    
+    engine.processBatch({NewOrder{day}, CancelOrder{1, "ES"}, NewOrder{makeOrder(2, Side::SELL, 106, 5)}});
+    
+    auto orderBook = engine.getOrderBook("ES");
+    ASSERT_TRUE(orderBook != nullptr);
+    EXPECT_EQ(orderBook->getBestAsk(), 106);
+    EXPECT_FALSE(engine.cancelOrder(1, "ES"));
+}
+
+TEST(MatchingEngineTest, IdleBooksAreCompactedAndPromotedAgain) {
+    MatchingEngine engine(2);
+    for (int i = 0; i < 1000; ++i) {
+        engine.configureInstrument("OPT" + to_string(i), BookConfig());
+    }
+    EXPECT_EQ(engine.instrumentCount(), 1000);
+    
+    Order order = makeOrder(1, Side::BUY, 100, 10);
+    order.symbol = "OPT7";
+    engine.processBatch({NewOrder{order}, NewOrder{makeOrder(2, Side::SELL, 101, 10)}});
+    EXPECT_EQ(engine.instrumentCount(), 1001);
+    ASSERT_TRUE(engine.getOrderBook("OPT7") != nullptr);
+    EXPECT_TRUE(engine.getOrderBook("OPT8") == nullptr);
+    
+    engine.processBatch({CancelOrder{1, "OPT7"}});
+    engine.compactIdleBooks();
+    EXPECT_TRUE(engine.getOrderBook("OPT7") == nullptr);
+    ASSERT_TRUE(engine.getOrderBook("ES") != nullptr);  // Still has a resting order
+    
+    engine.processBatch({NewOrder{order}});
+    auto orderBook = engine.getOrderBook("OPT7");
+    ASSERT_TRUE(orderBook != nullptr);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 100), 10);
+}
+
+TEST(OrderBookTest, CancelAccountOrdersBySide) {
+    OrderBook orderBook("ES");
+    orderBook.addOrdersBatch({makeOrder(1, Side::BUY, 100, 10, 5),
+                              makeOrder(2, Side::BUY, 99, 10, 6),
+                              makeOrder(3, Side::BUY, 98, 10, 5),
+                              makeOrder(4, Side::SELL, 105, 10, 5),
+                              makeOrder(5, Side::SELL, 106, 10, 6)});
+    
+    EXPECT_EQ(orderBook.cancelAccountOrders(5, Side::SELL), 1);
+    EXPECT_EQ(orderBook.getBestAsk(), 106);
+    EXPECT_EQ(orderBook.getBestBid(), 100);
+    
+    EXPECT_EQ(orderBook.cancelAccountOrders(5), 2);
+    EXPECT_EQ(orderBook.getBestBid(), 99);
+    EXPECT_EQ(orderBook.cancelAccountOrders(5), 0);
+    EXPECT_EQ(orderBook.orderCount(), 2);
+}
+
+TEST(MatchingEngineTest, MassCancelAcrossSymbolsKeepsCommandOrder) {
+    MatchingEngine engine(3);
+    vector<Command> commands;
+    for (uint64_t i = 0; i < 30; ++i) {
+        Order order = makeOrder(i + 1, i % 2 ? Side::SELL : Side::BUY, i % 2 ? 200 : 100, 1, 9);
+        order.symbol = "S" + to_string(i % 10);
+        commands.push_back(NewOrder{order});
+    }
+    Order other = makeOrder(100, Side::BUY, 100, 1, 4);
+    other.symbol = "S0";
+    commands.push_back(NewOrder{other});
+    commands.push_back(MassCancel{9, "", nullopt});
+    
+    // Arrives after the kill switch and must survive it
+    Order late = makeOrder(101, Side::BUY, 101, 1, 9);
+    late.symbol = "S3";
+    commands.push_back(NewOrder{late});
+    engine.processBatch(commands);
+    
+    for (int i = 0; i < 10; ++i) {
+        auto orderBook = engine.getOrderBook("S" + to_string(i));
+        ASSERT_TRUE(orderBook != nullptr);
+        size_t expected = (i == 0 || i == 3) ? 1 : 0;
+        EXPECT_EQ(orderBook->orderCount(), expected) << "S" << i;
+    }
+    
+    // Symbol and side scoped
+    engine.processBatch({MassCancel{9, "S3", Side::SELL}});
+    EXPECT_EQ(engine.getOrderBook("S3")->orderCount(), 1);
+    engine.processBatch({MassCancel{9, "S3", Side::BUY}});
+    EXPECT_EQ(engine.getOrderBook("S3")->orderCount(), 0);
+}
+
+TEST(MatchingEngineTest, MassCancelDropsExpiriesAndSkipsUnassignedOrders) {
+    MatchingEngine engine(2);
+    Order gtd = makeOrder(1, Side::BUY, 100, 10, 5);
+    gtd.timeInForce = TimeInForce::GTD;
+    gtd.expireTime = chrono::steady_clock::now() + chrono::milliseconds(20);
+    engine.processBatch({NewOrder{gtd}, NewOrder{makeOrder(2, Side::BUY, 99, 10)}});
+    
+    // No account is not an account: nothing to cancel
+    engine.processBatch({MassCancel{0, "ES", nullopt}});
+    auto orderBook = engine.getOrderBook("ES");
+    ASSERT_TRUE(orderBook != nullptr);
+    EXPECT_EQ(orderBook->orderCount(), 2);
+    
+    // The id comes back as a GTC order; a stale timer would take it out
+    engine.processBatch({MassCancel{5, "ES", nullopt}, NewOrder{makeOrder(1, Side::BUY, 98, 10, 5)}});
+    this_thread::sleep_for(chrono::milliseconds(30));
+    engine.expireOrders();
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 98), 10);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 99), 10);
+}
+
+TEST(MatchingEngineTest, OrdersThatLeaveByFillOrReduceDropTheirExpiry) {
+    MatchingEngine engine(1);
+    auto expiring = [](uint64_t id, Side side, uint32_t price, uint32_t quantity) {
+        Order order = makeOrder(id, side, price, quantity);
+        order.timeInForce = TimeInForce::GTD;
+        order.expireTime = chrono::steady_clock::now() + chrono::milliseconds(20);
+        return order;
+    };
+    
+    // 1 fills on arrival, 2 is filled while resting, 3 is reduced to nothing
+    engine.processBatch({NewOrder{makeOrder(10, Side::SELL, 100, 5)},
+                         NewOrder{expiring(1, Side::BUY, 100, 5)},
+                         NewOrder{expiring(2, Side::SELL, 105, 5)},
+                         NewOrder{makeOrder(11, Side::BUY, 105, 5)},
+                         NewOrder{expiring(3, Side::BUY, 90, 5)},
+                         ReduceOrder{3, "ES", 5}});
+    
+    // Their ids come back as GTC orders; a stale timer would take them out
+    engine.processBatch({NewOrder{makeOrder(1, Side::BUY, 91, 1)},
+                         NewOrder{makeOrder(2, Side::BUY, 92, 1)},
+                         NewOrder{makeOrder(3, Side::BUY, 93, 1)}});
+    this_thread::sleep_for(chrono::milliseconds(30));
+    engine.expireOrders();
+    auto orderBook = engine.getOrderBook("ES");
+    ASSERT_TRUE(orderBook != nullptr);
+    EXPECT_EQ(orderBook->orderCount(), 3);
+}
+
+TEST(MatchingEngineTest, ReusedOrderIdReplacesTheOldExpiry) {
+    MatchingEngine engine(1);
+    Order gtd = makeOrder(1, Side::BUY, 90, 5);
+    gtd.timeInForce = TimeInForce::GTD;
+    gtd.expireTime = chrono::steady_clock::now() + chrono::milliseconds(20);
+    Order later = makeOrder(2, Side::BUY, 80, 5);
+    later.timeInForce = TimeInForce::GTD;
+    later.expireTime = chrono::steady_clock::now() + chrono::hours(1);
+    engine.processBatch({NewOrder{gtd}, NewOrder{later}});
+    
+    // Both ids are reused while their first orders rest: 1 by a GTC order,
+    // 2 by a GTD order with an earlier expiry than the one it replaces
+    Order sooner = makeOrder(2, Side::BUY, 82, 5);
+    sooner.timeInForce = TimeInForce::GTD;
+    sooner.expireTime = chrono::steady_clock::now() + chrono::milliseconds(20);
+    engine.processBatch({NewOrder{makeOrder(1, Side::BUY, 91, 5)}, NewOrder{sooner}});
+    this_thread::sleep_for(chrono::milliseconds(30));
+    engine.expireOrders();
+    
+    auto orderBook = engine.getOrderBook("ES");
+    ASSERT_TRUE(orderBook != nullptr);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 91), 5);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 82), 0);
+}
+
+TEST(MatchingEngineTest, ReservedQuoteIdsAndUnassignedQuotesAreRejected) {
+    MatchingEngine engine(1);
+    auto now = chrono::steady_clock::now();
+    engine.processBatch({Quote{4, "ES", 99, 5, 101, 5, now}});
+    
+    // The client id is exactly account 4's bid quote id
+    uint64_t bidQuote = quoteOrderId(4, Side::BUY);
+    engine.processBatch({NewOrder{makeOrder(bidQuote, Side::BUY, 90, 7)},
+                         CancelOrder{bidQuote, "ES"},
+                         ReduceOrder{quoteOrderId(4, Side::SELL), "ES", 5},
+                         ReplaceOrder{1, bidQuote, "ES", 98, 1, now},
+                         Quote{0, "ES", 97, 5, 103, 5, now}});
+    EXPECT_EQ(engine.rejectedCommands(), 5);
+    EXPECT_FALSE(engine.cancelOrder(bidQuote, "ES"));
+    
+    auto orderBook = engine.getOrderBook("ES");
+    ASSERT_TRUE(orderBook != nullptr);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 99), 5);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::SELL, 101), 5);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 90), 0);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 97), 0);
+    EXPECT_EQ(orderBook->orderCount(), 2);
+}
+
+TEST(OrderBookTest, ReduceKeepsPriorityAndReplaceLosesIt) {
+    OrderBook orderBook("ES");
+    orderBook.addOrdersBatch({makeOrder(1, Side::BUY, 100, 10),
+                              makeOrder(2, Side::BUY, 100, 10, 3)});
+    
+    EXPECT_TRUE(orderBook.reduceOrder(1, 4));
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::BUY, 100), 16);
+    EXPECT_FALSE(orderBook.reduceOrder(42, 1));
+    
+    // Reducing by the whole size removes the order
+    orderBook.addOrder(makeOrder(5, Side::SELL, 110, 3));
+    EXPECT_TRUE(orderBook.reduceOrder(5, 3));
+    EXPECT_EQ(orderBook.getBestAsk(), 0);
+    
+    // Order 2 moves to 101 under a new id, keeping its side and account
+    auto replacement = orderBook.replaceOrder(2, 20, 101, 5, chrono::steady_clock::now());
+    ASSERT_TRUE(replacement.has_value());
+    EXPECT_EQ(replacement->side, Side::BUY);
+    EXPECT_EQ(replacement->account, 3);
+    EXPECT_EQ(orderBook.getBestBid(), 101);
+    EXPECT_FALSE(orderBook.cancelOrder(2));
+    EXPECT_FALSE(orderBook.replaceOrder(2, 21, 101, 5, chrono::steady_clock::now()).has_value());
+    
+    // Order 1 still comes first at 100 with its reduced size
+    orderBook.addOrder(makeOrder(3, Side::SELL, 100, 11));
+    auto fills = orderBook.matchOrders();
+    ASSERT_EQ(fills.size(), 2);
+    EXPECT_EQ(fills[0].buy.orderId, 20);
+    EXPECT_EQ(fills[1].buy.orderId, 1);
+    EXPECT_EQ(fills[1].quantity, 6);
+    EXPECT_EQ(orderBook.orderCount(), 0);
+}
+
+TEST(OrderBookTest, IcebergShowsOnlyItsSliceAndRequeuesAtTheBack) {
+    OrderBook orderBook("ES");
+    Order iceberg = makeOrder(1, Side::SELL, 100, 10);
+    iceberg.displayQuantity = 3;
+    orderBook.addOrdersBatch({iceberg, makeOrder(2, Side::SELL, 100, 5)});
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::SELL, 100), 8);
+    
+    // The first slice fills, the next one goes behind order 2
+    orderBook.addOrder(makeOrder(3, Side::BUY, 100, 4));
+    auto fills = orderBook.matchOrders();
+    ASSERT_EQ(fills.size(), 2);
+    EXPECT_EQ(fills[0].sell.orderId, 1);
+    EXPECT_EQ(fills[0].quantity, 3);
+    EXPECT_EQ(fills[1].sell.orderId, 2);
+    EXPECT_EQ(fills[1].quantity, 1);
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::SELL, 100), 7);
+    
+    orderBook.addOrder(makeOrder(4, Side::BUY, 100, 7));
+    fills = orderBook.matchOrders();
+    ASSERT_EQ(fills.size(), 2);
+    EXPECT_EQ(fills[0].sell.orderId, 2);
+    EXPECT_EQ(fills[1].sell.orderId, 1);
+    EXPECT_EQ(fills[1].quantity, 3);
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::SELL, 100), 3);
+    
+    // One hidden lot is left; a reduce takes it before the displayed slice
+    EXPECT_TRUE(orderBook.reduceOrder(1, 2));
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::SELL, 100), 2);
+    orderBook.addOrder(makeOrder(5, Side::BUY, 100, 5));
+    fills = orderBook.matchOrders();
+    ASSERT_EQ(fills.size(), 1);
+    EXPECT_EQ(fills[0].quantity, 2);
+    EXPECT_EQ(orderBook.getBestAsk(), 0);
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::BUY, 100), 3);
+}
+
+TEST(OrderBookTest, ProRataIcebergRefillsUntilItsReserveIsUsed) {
+    OrderBook orderBook("ES", BookConfig{MatchingMode::PRO_RATA, LockingMode::NONE});
+    Order iceberg = makeOrder(1, Side::SELL, 100, 10);
+    iceberg.displayQuantity = 2;
+    orderBook.addOrdersBatch({iceberg, makeOrder(2, Side::SELL, 100, 2), makeOrder(3, Side::BUY, 100, 11)});
+    
+    uint64_t filled = 0;
+    for (const Fill& fill : orderBook.matchOrders()) {
+        filled += fill.quantity;
+    }
+    EXPECT_EQ(filled, 11);
+    EXPECT_EQ(orderBook.orderCount(), 1);
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::SELL, 100), 1);
+    EXPECT_EQ(orderBook.getBestBid(), 0);
+}
+
+TEST(OrderBookTest, QuoteKeepsPriorityOnlyWhenItsSizeGoesDown) {
+    OrderBook orderBook("ES");
+    auto now = chrono::steady_clock::now();
+    EXPECT_EQ(orderBook.updateQuote(7, Side::BUY, 100, 10, now), QuoteUpdate::REQUEUED);
+    orderBook.addOrder(makeOrder(1, Side::BUY, 100, 5));
+    
+    EXPECT_EQ(orderBook.updateQuote(7, Side::BUY, 100, 6, now), QuoteUpdate::KEPT);
+    EXPECT_EQ(orderBook.getVolumeAtPrice(Side::BUY, 100), 11);
+    orderBook.addOrder(makeOrder(2, Side::SELL, 100, 6));
+    auto fills = orderBook.matchOrders();
+    ASSERT_EQ(fills.size(), 1);
+    EXPECT_EQ(fills[0].buy.orderId, quoteOrderId(7, Side::BUY));
+    EXPECT_EQ(fills[0].buy.account, 7);
+    
+    // Filled quotes are gone; a larger size goes behind order 1
+    EXPECT_EQ(orderBook.updateQuote(7, Side::BUY, 100, 2, now), QuoteUpdate::REQUEUED);
+    EXPECT_EQ(orderBook.updateQuote(7, Side::BUY, 100, 3, now), QuoteUpdate::REQUEUED);
+    orderBook.addOrder(makeOrder(3, Side::SELL, 100, 5));
+    fills = orderBook.matchOrders();
+    ASSERT_EQ(fills.size(), 1);
+    EXPECT_EQ(fills[0].buy.orderId, 1);
+    
+    EXPECT_EQ(orderBook.updateQuote(7, Side::BUY, 100, 0, now), QuoteUpdate::PULLED);
+    EXPECT_EQ(orderBook.updateQuote(7, Side::SELL, 105, 0, now), QuoteUpdate::NONE);
+    EXPECT_EQ(orderBook.orderCount(), 0);
+}
+
+TEST(MatchingEngineTest, MassQuoteReplacesQuotesAndAcksOnce) {
+    MatchingEngine engine(2);
+    auto now = chrono::steady_clock::now();
+    MassQuote massQuote;
+    for (const char* symbol : {"Q1", "Q2", "Q3"}) {
+        massQuote.quotes.push_back(Quote{7, symbol, 99, 10, 101, 10, now});
+    }
+    MassQuoteAck ack = engine.processMassQuote(massQuote);
+    EXPECT_EQ(ack.quotes, 3);
+    EXPECT_EQ(ack.sidesRequeued, 6);
+    
+    // Q1 shrinks, Q2 moves its bid, Q3 pulls its bid
+    massQuote.quotes = {Quote{7, "Q1", 99, 4, 101, 8, now}, Quote{7, "Q2", 100, 10, 101, 10, now},
+                        Quote{7, "Q3", 99, 0, 101, 10, now}};
+    ack = engine.processMassQuote(massQuote);
+    EXPECT_EQ(ack.quotes, 3);
+    EXPECT_EQ(ack.sidesKept, 4);
+    EXPECT_EQ(ack.sidesRequeued, 1);
+    EXPECT_EQ(ack.sidesPulled, 1);
+    EXPECT_EQ(engine.getOrderBook("Q1")->getVolumeAtPrice(Side::BUY, 99), 4);
+    EXPECT_EQ(engine.getOrderBook("Q2")->getBestBid(), 100);
+    EXPECT_EQ(engine.getOrderBook("Q3")->orderCount(), 1);
+    
+    // Quotes are ordinary resting orders of the account
+    engine.processBatch({MassCancel{7, "", nullopt}});
+    for (const char* symbol : {"Q1", "Q2", "Q3"}) {
+        EXPECT_EQ(engine.getOrderBook(symbol)->orderCount(), 0) << symbol;
+    }
+}
+
+TEST(MatchingEngineTest, InterleavedBooksEndInTheSameStateAsSequential) {
+    vector<Command> commands;
+    for (uint64_t i = 0; i < 600; ++i) {
+        string symbol = "S" + to_string(i % 7);
+        if (i % 5 == 4) {
+            commands.push_back(CancelOrder{i - 3, "S" + to_string((i - 3) % 7)});
+        } else if (i % 11 == 10) {
+            commands.push_back(ReduceOrder{i - 7, "S" + to_string((i - 7) % 7), 1});
+        } else {
+            Side side = (i / 3) % 2 ? Side::SELL : Side::BUY;
+            uint32_t price = static_cast<uint32_t>(side == Side::BUY ? 98 + i % 4 : 100 + i % 3);
+            Order order = makeOrder(i + 1, side, price, 1 + i % 4, 1 + i % 3);
+            order.symbol = symbol;
+            commands.push_back(NewOrder{order});
+        }
+    }
+    
+    MatchingEngine sequential(2);
+    MatchingEngine interleaved(2);
+    interleaved.setInterleaveWidth(4);
+    for (size_t start = 0; start < commands.size(); start += 150) {
+        vector<Command> batch(commands.begin() + start, commands.begin() + start + 150);
+        sequential.processBatch(batch);
+        interleaved.processBatch(batch);
+    }
+    
+    for (int i = 0; i < 7; ++i) {
+        string symbol = "S" + to_string(i);
+        auto expected = sequential.getOrderBook(symbol);
+        auto actual = interleaved.getOrderBook(symbol);
+        ASSERT_TRUE(expected != nullptr && actual != nullptr) << symbol;
+        EXPECT_EQ(actual->orderCount(), expected->orderCount()) << symbol;
+        EXPECT_EQ(actual->getBestBid(), expected->getBestBid()) << symbol;
+        EXPECT_EQ(actual->getBestAsk(), expected->getBestAsk()) << symbol;
+        for (uint32_t price = 98; price < 103; ++price) {
+            EXPECT_EQ(actual->getVolumeAtPrice(Side::BUY, price), expected->getVolumeAtPrice(Side::BUY, price));
+            EXPECT_EQ(actual->getVolumeAtPrice(Side::SELL, price), expected->getVolumeAtPrice(Side::SELL, price));
+        }
+    }
+    for (uint32_t account = 1; account <= 3; ++account) {
+        EXPECT_EQ(interleaved.accountExposure(account).fills, sequential.accountExposure(account).fills);
+        EXPECT_EQ(interleaved.accountExposure(account).boughtQuantity, sequential.accountExposure(account).boughtQuantity);
+    }
+    EXPECT_GT(sequential.accountExposure(1).fills, 0);
+}
@@ -0,0 +1,31 @@
+#include "gtest/gtest.h"
+#include "../src/core/OrderIndex.hpp"
+#include <unordered_map>
+
+using namespace tme;
+
+TEST(OrderIndexTest, MatchesAMapThroughGrowthAndErasure) {
+    OrderIndex<uint32_t> index;
+    unordered_map<uint64_t, uint32_t> expected;
+    
+    // Clustered and scattered ids, with erasures in the middle of probe runs
+    uint64_t state = 42;
+    for (uint32_t i = 0; i < 20000; ++i) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint64_t orderId = (i % 3 == 0) ? (state >> 40) : (state >> 52);
+        if (i % 4 == 0 && !expected.empty()) {
+            EXPECT_EQ(index.erase(orderId), expected.erase(orderId) == 1);
+        } else {
+            index.set(orderId, i);
+            expected[orderId] = i;
+        }
+    }
+    
+    EXPECT_EQ(index.size(), expected.size());
+    for (const auto& [orderId, value] : expected) {
+        const uint32_t* found = index.find(orderId);
+        ASSERT_TRUE(found != nullptr);
+        EXPECT_EQ(*found, value);
+    }
+    EXPECT_TRUE(index.find(uint64_t{1} << 63) == nullptr);
+}
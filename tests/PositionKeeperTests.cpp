@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+#include "../src/core/MatchingEngine.hpp"
+#include <thread>
+
+using namespace tme;
+
+namespace {
+
+Fill makeFill(uint32_t buyer, uint32_t seller, uint32_t price, uint32_t quantity) {
+    Fill fill;
+    fill.buy.account = buyer;
+    fill.sell.account = seller;
+    fill.price = price;
+    fill.quantity = quantity;
+    return fill;
+}
+
+Order makeOrder(uint64_t id, const string& symbol, Side side, uint32_t price, uint32_t quantity, uint32_t account) {
+    Order order;
+    order.orderId = id;
+    order.symbol = symbol;
+    order.price = price;
+    order.quantity = quantity;
+    order.side = side;
+    order.type = OrderType::LIMIT;
+    order.account = account;
+    order.timestamp = chrono::steady_clock::now();
+    return order;
+}
+
+} // namespace
+
+TEST(PositionKeeperTest, AveragesOpensRealizesClosesAndFlips) {
+    PositionKeeper keeper(2);
+    
+    keeper.onFills(0, 5, {makeFill(1, 2, 100, 10), makeFill(1, 2, 110, 10)});
+    Position position = keeper.position(1, 5);
+    EXPECT_EQ(position.netQuantity, 20);
+    EXPECT_DOUBLE_EQ(position.averagePrice(), 105);
+    EXPECT_EQ(keeper.position(2, 5).netQuantity, -20);
+    
+    // Sell 30 at 120: closes 20 for +300 and opens 10 short at 120
+    keeper.onFills(0, 5, {makeFill(3, 1, 120, 30)});
+    position = keeper.position(1, 5);
+    EXPECT_EQ(position.netQuantity, -10);
+    EXPECT_DOUBLE_EQ(position.averagePrice(), 120);
+    EXPECT_DOUBLE_EQ(position.realizedPnl, 300);
+    
+    // Another instrument on the other shard adds to the account totals
+    keeper.onFills(1, 6, {makeFill(1, 0, 50, 4)});
+    AccountExposure exposure = keeper.exposure(1);
+    EXPECT_DOUBLE_EQ(exposure.netNotional, -1200 + 200);
+    EXPECT_DOUBLE_EQ(exposure.grossNotional, 1200 + 200);
+    EXPECT_DOUBLE_EQ(exposure.realizedPnl, 300);
+    EXPECT_EQ(exposure.boughtQuantity, 24);
+    EXPECT_EQ(exposure.soldQuantity, 30);
+    EXPECT_EQ(exposure.fills, 4);
+    EXPECT_EQ(exposure.openPositions, 2);
+    
+    // Account 0 is never tracked
+    EXPECT_EQ(keeper.exposure(0).fills, 0);
+    EXPECT_EQ(keeper.exposure(1 << 20).fills, 0);
+}
+
+TEST(PositionKeeperTest, ReadersSeeConsistentSnapshotsWhileWriting) {
+    PositionKeeper keeper(1);
+    atomic<bool> done{false};
+    
+    // Every fill is 1 lot, so bought and fills must always agree
+    thread reader([&] {
+        while (!done.load()) {
+            AccountExposure exposure = keeper.exposure(7);
+            ASSERT_EQ(exposure.boughtQuantity, exposure.fills);
+            ASSERT_DOUBLE_EQ(exposure.netNotional, 100.0 * exposure.boughtQuantity);
+            Position position = keeper.position(7, 1);
+            ASSERT_EQ(position.boughtQuantity, static_cast<uint64_t>(position.netQuantity));
+        }
+    });
+    for (int i = 0; i < 20000; ++i) {
+        keeper.onFills(0, 1, {makeFill(7, 0, 100, 1)});
+    }
+    done = true;
+    reader.join();
+    EXPECT_EQ(keeper.exposure(7).fills, 20000);
+}
+
+TEST(MatchingEngineTest, FillsUpdateAccountExposure) {
+    MatchingEngine engine(2);
+    engine.processBatch({NewOrder{makeOrder(1, "ES", Side::SELL, 100, 10, 2)},
+                         NewOrder{makeOrder(2, "ES", Side::BUY, 100, 10, 1)},
+                         NewOrder{makeOrder(3, "NQ", Side::BUY, 200, 5, 3)},
+                         NewOrder{makeOrder(4, "NQ", Side::SELL, 200, 5, 1)}});
+    
+    AccountExposure exposure = engine.accountExposure(1);
+    EXPECT_EQ(exposure.fills, 2);
+    EXPECT_DOUBLE_EQ(exposure.netNotional, 1000 - 1000);
+    EXPECT_DOUBLE_EQ(exposure.grossNotional, 2000);
+    EXPECT_EQ(exposure.openPositions, 2);
+    EXPECT_DOUBLE_EQ(engine.accountExposure(2).netNotional, -1000);
+    EXPECT_DOUBLE_EQ(engine.accountExposure(3).netNotional, 1000);
+    
+    EXPECT_EQ(engine.accountPosition(1, "ES").netQuantity, 10);
+    EXPECT_EQ(engine.accountPosition(1, "NQ").netQuantity, -5);
+    EXPECT_DOUBLE_EQ(engine.accountPosition(1, "NQ").averagePrice(), 200);
+    EXPECT_EQ(engine.accountPosition(2, "NQ").netQuantity, 0);
+    EXPECT_EQ(engine.accountPosition(1, "CL").netQuantity, 0);
+}
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "../src/repl/Replication.hpp"
+#include <thread>
+
+using namespace tme;
+using namespace tme::repl;
+
+namespace {
+
+Order makeOrder(uint64_t id, Side side, uint32_t price, uint32_t quantity, uint32_t account = 0) {
+    Order order;
+    order.orderId = id;
+    order.symbol = id % 2 ? "ES" : "NQ";
+    order.price = price;
+    order.quantity = quantity;
+    order.side = side;
+    order.type = OrderType::LIMIT;
+    order.account = account;
+    order.timestamp = chrono::steady_clock::now();
+    return order;
+}
+
+} // namespace
+
+TEST(ReplicationTest, FollowerAppliesTheSameBatchesAndAcksThem) {
+    MatchingEngine followerEngine(2);
+    ReplicationFollower follower(followerEngine, 0);
+    uint64_t followerApplied = 0;
+    thread followerThread([&] { followerApplied = follower.run(); });
+    
+    MatchingEngine primaryEngine(2);
+    uint64_t last = 0;
+    {
+        ReplicationPrimary primary(primaryEngine, "127.0.0.1", follower.port(), 2);
+        uint64_t id = 1;
+        for (int batch = 0; batch < 20; ++batch) {
+            vector<Command> commands;
+            for (int i = 0; i < 10; ++i, ++id) {
+                Side side = id % 3 ? Side::BUY : Side::SELL;
+                commands.push_back(NewOrder{makeOrder(id, side, 95 + id % 10, 1 + id % 7, id % 4)});
+            }
+            commands.push_back(CancelOrder{id - 5, id % 2 ? "NQ" : "ES"});
+            commands.push_back(MassCancel{3, "", Side::SELL});
+            last = primary.processBatch(commands);
+        }
+        EXPECT_EQ(last, 20);
+        primary.waitForAck(last);
+        EXPECT_EQ(primary.lastAckedSequence(), last);
+    }
+    followerThread.join();
+    EXPECT_EQ(followerApplied, last);
+    
+    for (const string symbol : {"ES", "NQ"}) {
+        auto expected = primaryEngine.getOrderBook(symbol);
+        auto actual = followerEngine.getOrderBook(symbol);
+        ASSERT_TRUE(expected && actual);
+        EXPECT_EQ(actual->orderCount(), expected->orderCount());
+        EXPECT_EQ(actual->getBestBid(), expected->getBestBid());
+        EXPECT_EQ(actual->getBestAsk(), expected->getBestAsk());
+        for (uint32_t price = 95; price < 105; ++price) {
+            EXPECT_EQ(actual->getVolumeAtPrice(Side::BUY, price), expected->getVolumeAtPrice(Side::BUY, price));
+            EXPECT_EQ(actual->getVolumeAtPrice(Side::SELL, price), expected->getVolumeAtPrice(Side::SELL, price));
+        }
+    }
+}
+
+TEST(ReplicationTest, ExpiryAndSessionCloseAreSequencedFromThePrimary) {
+    MatchingEngine followerEngine(2);
+    ReplicationFollower follower(followerEngine, 0);
+    thread followerThread([&] { follower.run(); });
+    
+    // A later epoch than the follower's
+    this_thread::sleep_for(chrono::milliseconds(5));
+    MatchingEngine primaryEngine(2);
+    this_thread::sleep_for(chrono::milliseconds(5));
+    auto now = chrono::steady_clock::now();
+    {
+        ReplicationPrimary primary(primaryEngine, "127.0.0.1", follower.port());
+        primary.setSessionClose(now + chrono::hours(8));
+        
+        Order stale = makeOrder(1, Side::BUY, 100, 5);
+        stale.timeInForce = TimeInForce::GTD;
+        stale.expireTime = now - chrono::milliseconds(1);
+        Order gtd = makeOrder(3, Side::BUY, 99, 5);
+        gtd.timeInForce = TimeInForce::GTD;
+        gtd.expireTime = now + chrono::minutes(1);
+        Order day = makeOrder(5, Side::BUY, 98, 5);
+        day.timeInForce = TimeInForce::DAY;
+        primary.processBatch({NewOrder{stale}, NewOrder{gtd}, NewOrder{day},
+                              NewOrder{makeOrder(7, Side::BUY, 97, 5)}, NewOrder{makeOrder(2, Side::SELL, 110, 5)}});
+        
+        // Nothing expires until the primary says so, not even on arrival
+        primary.waitForAck(primary.lastSentSequence());
+        for (MatchingEngine* engine : {&primaryEngine, &followerEngine}) {
+            EXPECT_EQ(engine->getOrderBook("ES")->orderCount(), 4);
+        }
+        
+        primary.expireOrders(now + chrono::seconds(1));
+        primary.waitForAck(primary.lastSentSequence());
+        for (MatchingEngine* engine : {&primaryEngine, &followerEngine}) {
+            EXPECT_EQ(engine->getOrderBook("ES")->getBestBid(), 99);
+        }
+        primary.expireOrders(now + chrono::hours(1));
+        primary.waitForAck(primary.lastSentSequence());
+        for (MatchingEngine* engine : {&primaryEngine, &followerEngine}) {
+            EXPECT_EQ(engine->getOrderBook("ES")->getBestBid(), 98);
+        }
+        primary.expireOrders(now + chrono::hours(9));
+        
+        // The other entry points are replicated too
+        EXPECT_TRUE(primary.cancelOrder(2, "NQ"));
+        MassQuoteAck ack = primary.processMassQuote(MassQuote{{Quote{4, "NQ", 90, 3, 95, 3, now}}});
+        EXPECT_EQ(ack.sidesRequeued, 2);
+        primary.compactIdleBooks();
+    }
+    followerThread.join();
+    
+    for (MatchingEngine* engine : {&primaryEngine, &followerEngine}) {
+        auto es = engine->getOrderBook("ES");
+        ASSERT_TRUE(es != nullptr);
+        EXPECT_EQ(es->orderCount(), 1);
+        EXPECT_EQ(es->getBestBid(), 97);
+        auto nq = engine->getOrderBook("NQ");
+        ASSERT_TRUE(nq != nullptr);
+        EXPECT_EQ(nq->getVolumeAtPrice(Side::BUY, 90), 3);
+        EXPECT_EQ(nq->getVolumeAtPrice(Side::SELL, 95), 3);
+    }
+}
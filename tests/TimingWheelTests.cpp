@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+#include "../src/core/TimingWheel.hpp"
+#include <algorithm>
+
+using namespace tme;
+
+TEST(TimingWheelTest, FiresEachTimerAtItsTickAcrossLevels) {
+    TimingWheel<int> wheel;
+    vector<int> expired;
+    
+    // One timer per level, plus one past the wheel's horizon
+    for (int tick : {5, 100, 5000, 300000, 20000000}) {
+        wheel.schedule(tick, tick);
+    }
+    
+    for (int tick : {5, 100, 5000, 300000, 20000000}) {
+        wheel.advance(tick - 1, expired);
+        EXPECT_TRUE(expired.empty()) << "fired early before " << tick;
+        wheel.advance(tick, expired);
+        ASSERT_EQ(expired.size(), 1);
+        EXPECT_EQ(expired[0], tick);
+        expired.clear();
+    }
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimingWheelTest, CancelledTimersNeverFire) {
+    TimingWheel<int> wheel;
+    vector<int> expired;
+    
+    auto a = wheel.schedule(10, 1);
+    wheel.schedule(10, 2);
+    auto c = wheel.schedule(70, 3);
+    wheel.cancel(a);
+    wheel.cancel(c);
+    
+    wheel.advance(100, expired);
+    ASSERT_EQ(expired.size(), 1);
+    EXPECT_EQ(expired[0], 2);
+}
+
+TEST(TimingWheelTest, BurstIsReturnedInOneAdvance) {
+    TimingWheel<int> wheel(1000);
+    vector<int> expired;
+    
+    for (int i = 0; i < 1000; ++i) {
+        wheel.schedule(1000 + 1 + (i % 200), i);
+    }
+    wheel.advance(1500, expired);
+    
+    EXPECT_EQ(expired.size(), 1000);
+    sort(expired.begin(), expired.end());
+    EXPECT_EQ(expired.front(), 0);
+    EXPECT_EQ(expired.back(), 999);
+}
@@ -0,0 +1,262 @@
+#include "gtest/gtest.h"
+#include "../src/transport/ShmTransport.hpp"
+#include <thread>
+#include <unistd.h>
+
+using namespace tme;
+using namespace tme::transport;
+
+TEST(ShmRingTest, PushPopUntilFullAndEmpty) {
+    alignas(64) static char memory[16384];
+    ASSERT_LE(ShmRing<int>::bytesFor(8), sizeof(memory));
+    auto ring = ShmRing<int>::initialize(memory, 8);
+    
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_TRUE(ring.tryPush(i));
+    }
+    EXPECT_FALSE(ring.tryPush(8));
+    
+    int value = -1;
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(ring.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(ring.tryPop(value));
+}
+
+TEST(ShmRingTest, ConcurrentProducersLoseNothing) {
+    alignas(64) static char memory[1 << 16];
+    auto ring = ShmRing<uint64_t>::initialize(memory, 256);
+    const uint64_t perProducer = 20000;
+    
+    vector<thread> producers;
+    for (uint64_t p = 0; p < 3; ++p) {
+        producers.emplace_back([&ring, p, perProducer] {
+            for (uint64_t i = 1; i <= perProducer; ++i) {
+                while (!ring.tryPush(p * perProducer + i)) {
+                }
+            }
+        });
+    }
+    
+    uint64_t sum = 0;
+    uint64_t count = 0;
+    uint64_t value;
+    while (count < 3 * perProducer) {
+        if (ring.tryPop(value)) {
+            sum += value;
+            ++count;
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    
+    uint64_t n = 3 * perProducer;
+    EXPECT_EQ(sum, n * (n + 1) / 2);
+}
+
+TEST(ShmRingTest, SkipsSlotsClaimedButNeverWritten) {
+    alignas(64) static char memory[16384];
+    auto ring = ShmRing<int>::initialize(memory, 8);
+    auto* header = reinterpret_cast<ShmRing<int>::Header*>(memory);
+    
+    EXPECT_TRUE(ring.tryPush(1));
+    header->enqueuePos.fetch_add(1);    // A producer that died after claiming
+    EXPECT_TRUE(ring.tryPush(3));
+    
+    int value = 0;
+    EXPECT_FALSE(ring.skipUnwritten());
+    ASSERT_TRUE(ring.tryPop(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_FALSE(ring.tryPop(value));
+    EXPECT_TRUE(ring.skipUnwritten());
+    ASSERT_TRUE(ring.tryPop(value));
+    EXPECT_EQ(value, 3);
+    EXPECT_FALSE(ring.skipUnwritten());
+}
+
+TEST(ShmTransportTest, GatewayCommandsReachEngineAndAreAcknowledged) {
+    const string name = "/tme_test_" + to_string(getpid());
+    MatchingEngine engine(2);
+    ShmCommandReceiver receiver(engine, name);
+    ShmGatewayClient client(name);
+    
+    Order order;
+    order.orderId = 7;
+    order.symbol = "AAPL";
+    order.price = 100;
+    order.quantity = 10;
+    order.side = Side::BUY;
+    order.type = OrderType::LIMIT;
+    
+    EXPECT_EQ(client.send(NewOrder{order}), 1);
+    EXPECT_EQ(client.send(CancelOrder{99, "AAPL"}), 2);
+    EXPECT_EQ(receiver.poll(16), 2);
+    
+    auto orderBook = engine.getOrderBook("AAPL");
+    ASSERT_TRUE(orderBook != nullptr);
+    EXPECT_EQ(orderBook->getVolumeAtPrice(Side::BUY, 100), 10);
+    
+    ResponseRecord response;
+    ASSERT_TRUE(client.pollResponse(response));
+    EXPECT_EQ(response.sequence, 1);
+    EXPECT_EQ(response.orderId, 7);
+    ASSERT_TRUE(client.pollResponse(response));
+    EXPECT_EQ(response.sequence, 2);
+    EXPECT_FALSE(client.pollResponse(response));
+}
+
+TEST(ShmTransportTest, ReceiverDrainsWhatItsControllerAllows) {
+    const string name = "/tme_test_batch_" + to_string(getpid());
+    MatchingEngine engine(1);
+    ShmCommandReceiver receiver(engine, name);
+    receiver.setBatching(BatchingConfig{chrono::microseconds(10), 2, 2});
+    ShmGatewayClient client(name);
+    
+    for (uint64_t i = 1; i <= 5; ++i) {
+        client.send(CancelOrder{i, "AAPL"});
+    }
+    EXPECT_EQ(receiver.poll(16), 2);
+    EXPECT_EQ(receiver.poll(1), 1);
+    EXPECT_EQ(receiver.poll(16), 2);
+    EXPECT_EQ(receiver.poll(16), 0);
+    EXPECT_EQ(receiver.batchStats().items, 5);
+}
+
+TEST(TransportRecordsTest, RejectsSymbolsThatWouldBeTruncated) {
+    const string occ = "AAPL  250117C00150000";
+    CommandRecord record = toRecord(CancelOrder{1, occ});
+    auto cancel = get<CancelOrder>(toCommand(record));
+    EXPECT_EQ(cancel.symbol, occ);
+    
+    EXPECT_THROW(toRecord(CancelOrder{1, string(SYMBOL_CAPACITY + 1, 'X')}), invalid_argument);
+}
+
+TEST(TransportRecordsTest, RejectsReservedQuoteIdsAndUnassignedQuotes) {
+    auto now = chrono::steady_clock::now();
+    Order order;
+    order.orderId = quoteOrderId(4, Side::BUY);
+    order.symbol = "ES";
+    order.price = 100;
+    order.quantity = 1;
+    order.side = Side::BUY;
+    order.type = OrderType::LIMIT;
+    
+    EXPECT_FALSE(isValid(toRecord(NewOrder{order})));
+    EXPECT_FALSE(isValid(toRecord(CancelOrder{order.orderId, "ES"})));
+    EXPECT_FALSE(isValid(toRecord(ReplaceOrder{1, order.orderId, "ES", 100, 1, now})));
+    EXPECT_FALSE(isValid(toRecord(Quote{0, "ES", 99, 5, 101, 5, now})));
+    EXPECT_THROW(toCommand(toRecord(NewOrder{order})), invalid_argument);
+    
+    order.orderId = 1;
+    EXPECT_TRUE(isValid(toRecord(NewOrder{order})));
+    EXPECT_TRUE(isValid(toRecord(Quote{4, "ES", 99, 5, 101, 5, now})));
+}
+
+TEST(ShmTransportTest, ProducerSlotsAreReleasedAndReused) {
+    const string name = "/tme_test_slots_" + to_string(getpid());
+    MatchingEngine engine(1);
+    ShmConfig config;
+    config.maxProducers = 2;
+    ShmCommandReceiver receiver(engine, name, config);
+    
+    auto first = make_unique<ShmGatewayClient>(name);
+    ShmGatewayClient second(name);
+    EXPECT_THROW(ShmGatewayClient{name}, runtime_error);
+    
+    // Acknowledged after its sender has gone, so the next owner must skip it
+    first->send(CancelOrder{1, "AAPL"});
+    first.reset();
+    ShmGatewayClient third(name);
+    EXPECT_EQ(receiver.poll(16), 1);
+    third.send(CancelOrder{2, "AAPL"});
+    EXPECT_EQ(receiver.poll(16), 1);
+    
+    ResponseRecord response;
+    ASSERT_TRUE(third.pollResponse(response));
+    EXPECT_EQ(response.orderId, 2);
+    EXPECT_FALSE(third.pollResponse(response));
+    EXPECT_FALSE(second.pollResponse(response));
+}
+
+TEST(ShmTransportTest, MassQuoteIsDrainedAndAcknowledgedAsOneCommand) {
+    const string name = "/tme_test_mass_quote_" + to_string(getpid());
+    MatchingEngine engine(2);
+    ShmCommandReceiver receiver(engine, name);
+    ShmGatewayClient client(name);
+    auto now = chrono::steady_clock::now();
+    
+    client.send(CancelOrder{1, "ES"});
+    MassQuote massQuote{{Quote{4, "ES", 99, 5, 101, 5, now}, Quote{4, "NQ", 199, 2, 201, 2, now}}};
+    EXPECT_EQ(client.send(massQuote), 2);
+    client.send(CancelOrder{2, "NQ"});
+    EXPECT_EQ(receiver.poll(16), 3);
+    
+    auto es = engine.getOrderBook("ES");
+    auto nq = engine.getOrderBook("NQ");
+    ASSERT_TRUE(es != nullptr && nq != nullptr);
+    EXPECT_EQ(es->getVolumeAtPrice(Side::BUY, 99), 5);
+    EXPECT_EQ(nq->getVolumeAtPrice(Side::SELL, 201), 2);
+    
+    ResponseRecord response;
+    for (uint64_t sequence = 1; sequence <= 3; ++sequence) {
+        ASSERT_TRUE(client.pollResponse(response));
+        EXPECT_EQ(response.sequence, sequence);
+    }
+    EXPECT_FALSE(client.pollResponse(response));
+    
+    MassQuote oversized;
+    oversized.quotes.assign(ShmConfig().commandCapacity, Quote{4, "ES", 99, 5, 101, 5, now});
+    EXPECT_THROW(client.trySend(oversized), invalid_argument);
+}
+
+TEST(ShmTransportTest, MalformedRecordsAreRejectedWithoutStallingTheRing) {
+    const string name = "/tme_test_malformed_" + to_string(getpid());
+    MatchingEngine engine(1);
+    ShmConfig config;
+    config.massQuoteWait = chrono::microseconds(50);
+    ShmCommandReceiver receiver(engine, name, config);
+    auto segment = ShmSegment::open(name);
+    uint32_t producer = segment->registerProducer();
+    uint32_t generation = segment->producerGeneration(producer);
+    auto push = [&](CommandRecord record, uint64_t sequence) {
+        record.producerId = producer;
+        record.producerGeneration = generation;
+        record.sequence = sequence;
+        ASSERT_TRUE(segment->commands().tryPush(record));
+    };
+    auto now = chrono::steady_clock::now();
+    
+    CommandRecord badSide = toRecord(CancelOrder{1, "ES"});
+    badSide.type = RecordType::NEW_ORDER;
+    badSide.side = 7;
+    push(badSide, 1);
+    
+    // Claims two quotes but only one follows it
+    CommandRecord header{};
+    header.type = RecordType::MASS_QUOTE;
+    header.quantity = 2;
+    push(header, 2);
+    push(toRecord(Quote{4, "ES", 99, 5, 101, 5, now}), 2);
+    
+    // A quote without its header
+    push(toRecord(Quote{4, "ES", 99, 5, 101, 5, now}), 3);
+    push(toRecord(CancelOrder{1, "ES"}), 4);
+    
+    EXPECT_EQ(receiver.poll(16), 1);
+    EXPECT_EQ(receiver.rejectedRecords(), 3);
+    EXPECT_TRUE(engine.getOrderBook("ES") == nullptr);
+    
+    vector<pair<uint64_t, ResponseStatus>> responses;
+    ResponseRecord response;
+    while (segment->responses(producer).tryPop(response)) {
+        responses.emplace_back(response.sequence, response.status);
+    }
+    vector<pair<uint64_t, ResponseStatus>> expected = {{1, ResponseStatus::REJECTED},
+                                                      {2, ResponseStatus::REJECTED},
+                                                      {3, ResponseStatus::REJECTED},
+                                                      {4, ResponseStatus::ACCEPTED}};
+    EXPECT_EQ(responses, expected);
+    segment->releaseProducer(producer);
+}